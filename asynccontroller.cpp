@@ -0,0 +1,171 @@
+#include "asynccontroller.hpp"
+
+#include "log.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+
+/// @return ControllerBase::Result The result of a transaction that returned @c nack.
+/// @discussion A transaction may fail without an octet that was not acknowledged.
+ControllerBase::Result outcome(const ControllerBase & controller, bool nack)
+{
+    if (!nack) {
+        return ControllerBase::Result::ACK;
+    }
+
+    auto result = controller.result();
+    return result == ControllerBase::Result::ACK ? ControllerBase::Result::NACK : result;
+}
+
+} // namespace
+
+class AsyncController::Impl
+{
+    /// The controller, which is only used by the controller thread.
+    ControllerBase controller_;
+
+    /// This mutex protects the following member variables.
+    std::mutex mutex_;
+
+    /// Queued work.
+    std::deque<std::function<void(ControllerBase &)>> queue_;
+
+    /// True when the controller thread should exit (once the queue is empty).
+    bool stopping_;
+
+    /// Signalled when work is queued, or when stopping.
+    std::condition_variable condition_;
+
+    /// Controller thread.
+    std::thread thread_;
+
+    void run(const std::string & name)
+    {
+        Log::set_prefix(name);
+
+        for (;;) {
+            std::function<void(ControllerBase &)> work;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                condition_.wait(lock, [&]{
+                    return !queue_.empty() || stopping_;
+                });
+
+                if (queue_.empty()) {
+                    return;
+                }
+
+                work = std::move(queue_.front());
+                queue_.pop_front();
+            }
+
+            work(controller_);
+        }
+    }
+
+public:
+    Impl(const std::string & name, Bus * bus) : controller_{name, bus}, mutex_{}, queue_{}, stopping_{}, condition_{}, thread_{}
+    {
+        thread_ = std::thread([this, name]{
+            run(name);
+        });
+    }
+
+    ~Impl()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        condition_.notify_one();
+        thread_.join();
+    }
+
+    void enqueue(std::function<void(ControllerBase &)> work)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(std::move(work));
+        }
+        condition_.notify_one();
+    }
+
+    template<class T>
+    std::future<T> submit(std::function<T(ControllerBase &)> transaction)
+    {
+        // std::function must be copyable, so share the (move-only) task.
+        auto task = std::make_shared<std::packaged_task<T(ControllerBase &)>>(std::move(transaction));
+        auto future = task->get_future();
+
+        enqueue([task](ControllerBase & controller){
+            (*task)(controller);
+        });
+
+        return future;
+    }
+};
+
+AsyncController::AsyncController(const std::string & name, Bus * bus) : pimpl{std::make_unique<Impl>(name, bus)}
+{
+}
+
+AsyncController::~AsyncController() = default;
+
+std::future<ControllerBase::Result> AsyncController::submit(Transaction transaction)
+{
+    return pimpl->submit<ControllerBase::Result>([transaction = std::move(transaction)](ControllerBase & controller){
+        return outcome(controller, transaction(controller));
+    });
+}
+
+void AsyncController::submit(Transaction transaction, Completion completion)
+{
+    pimpl->enqueue([transaction = std::move(transaction), completion = std::move(completion)](ControllerBase & controller){
+        // Exceptions must not escape the controller thread.
+        auto result = ControllerBase::Result::TIMEOUT;
+        std::exception_ptr error;
+        try {
+            result = outcome(controller, transaction(controller));
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        try {
+            completion(result, error);
+        } catch (const std::exception & e) {
+            LOG_INFO << "completion threw: " << e.what();
+        } catch (...) {
+            LOG_INFO << "completion threw";
+        }
+    });
+}
+
+std::future<ControllerBase::Result> AsyncController::write(uint8_t address, std::vector<uint8_t> data)
+{
+    return submit([address, data = std::move(data)](ControllerBase & controller){
+        return controller.write(address, data.data(), data.size());
+    });
+}
+
+std::future<std::tuple<ControllerBase::Result, std::vector<uint8_t>>> AsyncController::read(uint8_t address, std::size_t length)
+{
+    return pimpl->submit<std::tuple<ControllerBase::Result, std::vector<uint8_t>>>([address, length](ControllerBase & controller){
+        std::vector<uint8_t> buffer(length);
+        auto nack = controller.read(address, buffer.data(), buffer.size());
+        return std::make_tuple(outcome(controller, nack), std::move(buffer));
+    });
+}
+
+std::future<std::tuple<ControllerBase::Result, std::vector<uint8_t>>> AsyncController::write_then_read(uint8_t address, std::vector<uint8_t> data, std::size_t length)
+{
+    return pimpl->submit<std::tuple<ControllerBase::Result, std::vector<uint8_t>>>([address, data = std::move(data), length](ControllerBase & controller){
+        std::vector<uint8_t> buffer(length);
+        auto nack = controller.write_then_read(address, data.data(), data.size(), buffer.data(), buffer.size());
+        return std::make_tuple(outcome(controller, nack), std::move(buffer));
+    });
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "controllerbase.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+class Bus;
+
+/// Asynchronous controller class.
+/// @discussion Models an I²C controller that executes queued transactions, back-to-back, on its own thread.
+/// Transactions may be queued from any thread.
+/// Each result is the @c ControllerBase::Result of the transaction, captured on the controller thread before the
+/// next transaction runs.
+/// The bus must not have a scheduler, since the controller runs on its own thread.
+class AsyncController
+{
+    class Impl;
+    std::unique_ptr<Impl> pimpl;
+
+public:
+    /// A transaction, executed on the controller thread.
+    /// @return bool True if an octet was not acknowledged, arbitration was lost, or the transaction timed out.
+    using Transaction = std::function<bool(ControllerBase &)>;
+
+    /// Completion callback, called on the controller thread.
+    /// @discussion An exception thrown by the callback is discarded.
+    /// @param result The result of the transaction.
+    /// @param error The exception thrown by the transaction (then @c result is @c ControllerBase::Result::TIMEOUT), or nullptr.
+    using Completion = std::function<void(ControllerBase::Result result, std::exception_ptr error)>;
+
+    /// Constructor.
+    /// @param name The name of the controller.
+    /// @param bus The bus to connect to.
+    AsyncController(const std::string & name, Bus * bus);
+
+    /// Destructor.
+    /// @discussion Queued transactions are completed before the controller thread exits.
+    ~AsyncController();
+
+    /// Queue a transaction.
+    /// @return std::future<ControllerBase::Result> The result of the transaction, or the exception that it threw.
+    std::future<ControllerBase::Result> submit(Transaction transaction);
+
+    /// Queue a transaction.
+    /// @param completion Called with the result of the transaction.
+    void submit(Transaction transaction, Completion completion);
+
+    /// Queue a write.
+    /// @param address The 7-bit target address.
+    /// @param data The octets to send.
+    /// @return std::future<ControllerBase::Result> The result of the write.
+    std::future<ControllerBase::Result> write(uint8_t address, std::vector<uint8_t> data);
+
+    /// Queue a read.
+    /// @param address The 7-bit target address.
+    /// @param length The number of octets to read.
+    /// @return std::future<ControllerBase::Result> The result of the read.
+    /// @return std::future<std::vector<uint8_t>> The octets read.
+    std::future<std::tuple<ControllerBase::Result, std::vector<uint8_t>>> read(uint8_t address, std::size_t length);
+
+    /// Queue a write, then read after a repeated START condition.
+    /// @param address The 7-bit target address.
+    /// @param data The octets to send.
+    /// @param length The number of octets to read.
+    /// @return std::future<ControllerBase::Result> The result of the transaction.
+    /// @return std::future<std::vector<uint8_t>> The octets read.
+    std::future<std::tuple<ControllerBase::Result, std::vector<uint8_t>>> write_then_read(uint8_t address, std::vector<uint8_t> data, std::size_t length);
+};
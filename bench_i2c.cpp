@@ -0,0 +1,390 @@
+#include "bus.hpp"
+#include "controllerbase.hpp"
+#include "eeprom.hpp"
+#include "log.hpp"
+#include "scheduler.hpp"
+#include "smbus.hpp"
+#include "smbustarget.hpp"
+#include "target.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+/// Runs a workload on a bus, and reports throughput as JSON.
+class Bench
+{
+public:
+    enum class Mode
+    {
+        /// Each node runs on its own thread.
+        Threaded,
+        /// Nodes run as cooperative tasks on one thread.
+        Cooperative
+    };
+
+    /// Workload run by the controller.
+    /// @return std::size_t The number of octets transferred (including address octets).
+    using Workload = std::function<std::size_t(ControllerBase & controller)>;
+
+    /// Benchmark parameters, as JSON members.
+    using Parameters = std::vector<std::pair<std::string, std::string>>;
+
+    /// Makes a target.
+    template <typename T>
+    using Make = std::function<std::unique_ptr<T>(uint8_t address, Bus * bus)>;
+
+    /// Reports further results, as JSON members, after the workloads.
+    using Report = std::function<Parameters()>;
+
+private:
+    std::vector<std::string> results_;
+
+    /// Serializes the completion of controllers.
+    std::mutex mutex_;
+
+    /// Wait policy of the threads.
+    Bus::WaitPolicy policy_ = Bus::WaitPolicy::Park;
+
+    static const char * name(Mode mode)
+    {
+        return mode == Mode::Threaded ? "threaded" : "cooperative";
+    }
+
+public:
+    /// Set the wait policy of subsequent threaded runs.
+    void wait_policy(Bus::WaitPolicy policy)
+    {
+        policy_ = policy;
+    }
+
+    /// Run a workload with example targets.
+    /// @param benchmark The name of the benchmark.
+    /// @param parameters Parameters that identify the result.
+    /// @param mode How the nodes run.
+    /// @param addresses The addresses of the targets.
+    /// @param workload The workload.
+    void run(const std::string & benchmark, const Parameters & parameters, Mode mode, const std::vector<uint8_t> & addresses, const Workload & workload)
+    {
+        run<Target>(benchmark, parameters, mode, addresses, workload, [](uint8_t address, Bus * bus)
+        {
+            return std::make_unique<Target>("T" + Log::octet(address), address, bus);
+        });
+    }
+
+    /// Run a workload.
+    /// @param make Makes the target at each address.
+    template <typename T>
+    void run(const std::string & benchmark, const Parameters & parameters, Mode mode, const std::vector<uint8_t> & addresses, const Workload & workload, const Make<T> & make)
+    {
+        run(benchmark, parameters, mode, addresses, std::vector<Workload>{workload}, make);
+    }
+
+    /// Run workloads on contending controllers.
+    /// @param workloads The workload of each controller.
+    /// @param report Reports further results, or empty.
+    template <typename T>
+    void run(const std::string & benchmark, const Parameters & parameters, Mode mode, const std::vector<uint8_t> & addresses, const std::vector<Workload> & workloads, const Make<T> & make, const Report & report = {})
+    {
+        Scheduler scheduler;
+        Bus bus(mode == Mode::Cooperative ? &scheduler : nullptr);
+        bus.wait_policy(policy_);
+
+        std::vector<std::unique_ptr<T>> targets{};
+        for (auto address : addresses) {
+            targets.push_back(make(address, &bus));
+        }
+
+        bus.reset_statistics();
+        auto start = std::chrono::steady_clock::now();
+        auto cpu_start = std::clock();
+
+        std::size_t octets{};
+        std::size_t running = workloads.size();
+        std::chrono::duration<double> elapsed{};
+        std::clock_t cpu{};
+
+        // Each controller detaches from the bus when its workload is complete, so that it does not hold up the others.
+        auto measure = [&](std::size_t i)
+        {
+            std::size_t n{};
+            {
+                ControllerBase controller("C" + Log::octet(static_cast<uint8_t>(i)), &bus);
+                n = workloads[i](controller);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            octets += n;
+            if (--running == 0) {
+                elapsed = std::chrono::steady_clock::now() - start;
+                cpu = std::clock() - cpu_start;
+
+                for (auto & target : targets) {
+                    target->stop();
+                }
+            }
+        };
+
+        if (mode == Mode::Cooperative) {
+            for (auto & target : targets) {
+                auto t = target.get();
+                scheduler.spawn("T", [t]
+                {
+                    t->run();
+                });
+            }
+            for (std::size_t i = 0; i < workloads.size(); ++i) {
+                scheduler.spawn("C", [&measure, i]
+                {
+                    measure(i);
+                });
+            }
+            scheduler.run();
+        } else {
+            std::vector<std::thread> threads{};
+            for (auto & target : targets) {
+                auto t = target.get();
+                threads.emplace_back([t]
+                {
+                    t->run();
+                });
+            }
+            for (std::size_t i = 0; i < workloads.size(); ++i) {
+                threads.emplace_back([&measure, i]
+                {
+                    measure(i);
+                });
+            }
+            for (auto & thread : threads) {
+                thread.join();
+            }
+        }
+
+        Log::flush();
+
+        auto statistics = bus.statistics();
+        auto events = statistics.events;
+        auto seconds = elapsed.count();
+
+        std::string result = "{\"benchmark\": \"" + benchmark + "\", \"mode\": \"" + name(mode) + "\"";
+        for (const auto & [key, value] : parameters) {
+            result += ", \"" + key + "\": " + value;
+        }
+        result += ", \"octets\": " + std::to_string(octets);
+        result += ", \"events\": " + std::to_string(events);
+        result += ", \"seconds\": " + std::to_string(seconds);
+        result += ", \"octets_per_second\": " + std::to_string(static_cast<double>(octets) / seconds);
+        result += ", \"events_per_second\": " + std::to_string(static_cast<double>(events) / seconds);
+        // Processor time of all threads, per second: 1 is one processor fully used.
+        result += ", \"cpu\": " + std::to_string(static_cast<double>(cpu) / CLOCKS_PER_SEC / seconds);
+        result += ", \"publish_time\": " + std::to_string(statistics.publish_time);
+        if (report) {
+            for (const auto & [key, value] : report()) {
+                result += ", \"" + key + "\": " + value;
+            }
+        }
+        result += "}";
+
+        std::fprintf(stderr, "%s\n", result.c_str());
+        results_.push_back(result);
+    }
+
+    /// Write results.
+    void write(const std::string & path) const
+    {
+        std::ofstream file(path);
+        file << "{\n  \"results\": [\n";
+        for (std::size_t i = 0; i < results_.size(); ++i) {
+            file << "    " << results_[i] << (i + 1 < results_.size() ? ",\n" : "\n");
+        }
+        file << "  ]\n}\n";
+    }
+};
+
+/// @return Workload Workload that writes @c count messages of @c length octets to @c address.
+Bench::Workload writes(uint8_t address, std::size_t count, std::size_t length)
+{
+    return [=](ControllerBase & controller)
+    {
+        std::vector<uint8_t> data(length, 0x5A);
+        for (std::size_t i = 0; i < count; ++i) {
+            controller.write(address, data.data(), data.size());
+        }
+        return count * (1 + length);
+    };
+}
+
+/// @return Workload Workload that reads @c count messages of @c length octets from @c address.
+Bench::Workload reads(uint8_t address, std::size_t count, std::size_t length)
+{
+    return [=](ControllerBase & controller)
+    {
+        std::vector<uint8_t> buffer(length);
+        for (std::size_t i = 0; i < count; ++i) {
+            controller.read(address, buffer.data(), buffer.size());
+        }
+        return count * (1 + length);
+    };
+}
+
+/// @return Workload Workload that writes, then reads, @c count SMBus blocks of the largest size to @c address.
+/// @param pec True to append and verify Packet Error Codes.
+Bench::Workload smbus_blocks(uint8_t address, std::size_t count, bool pec)
+{
+    return [=](ControllerBase & controller)
+    {
+        Smbus smbus(&controller);
+        smbus.pec(pec);
+
+        std::vector<uint8_t> data(Smbus::BLOCK_MAX, 0x5A);
+        for (std::size_t i = 0; i < count; ++i) {
+            smbus.write_block_data(address, 0x30, data.data(), data.size());
+            smbus.read_block_data(address, 0x30, data.data());
+        }
+        // Address, command code and length octets, the block and the PEC, written; then the address octets read.
+        return count * (2 * (3 + Smbus::BLOCK_MAX + (pec ? 1 : 0)) + 1);
+    };
+}
+
+/// @return Workload Workload that writes @c count messages of @c length octets to @c address, retrying each message
+/// until it is not lost to another controller.
+/// @param lost Counts lost arbitrations.
+Bench::Workload contended_writes(uint8_t address, std::size_t count, std::size_t length, std::atomic<std::size_t> & lost)
+{
+    return [=, &lost](ControllerBase & controller)
+    {
+        std::vector<uint8_t> data(length, 0x5A);
+        for (std::size_t i = 0; i < count; ++i) {
+            while (controller.write(address, data.data(), data.size()) && controller.result() == ControllerBase::Result::ARBITRATION_LOST) {
+                lost++;
+            }
+        }
+        return count * (1 + length);
+    };
+}
+
+/// @return std::vector<uint8_t> @c n target addresses, from 0x08.
+std::vector<uint8_t> addresses(std::size_t n)
+{
+    std::vector<uint8_t> addresses{};
+    for (std::size_t i = 0; i < n; ++i) {
+        addresses.push_back(static_cast<uint8_t>(0x08 + i));
+    }
+    return addresses;
+}
+
+} // namespace
+
+/// Benchmarks the bus engine.
+/// @discussion Results are written as JSON to the file named by the first argument (default bench_i2c.json).
+int main(int argc, char * argv[])
+{
+    const std::string path = argc > 1 ? argv[1] : "bench_i2c.json";
+
+    Bench bench;
+    Log::set_level(Log::Level::Off);
+
+    // Throughput versus number of attached targets.
+    for (auto mode : {Bench::Mode::Cooperative, Bench::Mode::Threaded}) {
+        for (std::size_t n : {1, 2, 4, 8, 16, 32, 64}) {
+            bench.run("targets", {{"targets", std::to_string(n)}}, mode, addresses(n), writes(0x08, 20, 8));
+        }
+    }
+
+    // Single octet transfers versus a burst of the same octets.
+    for (auto mode : {Bench::Mode::Cooperative, Bench::Mode::Threaded}) {
+        bench.run("transfer", {{"transfer", "\"single\""}}, mode, addresses(4), writes(0x08, 64, 1));
+        bench.run("transfer", {{"transfer", "\"burst\""}}, mode, addresses(4), writes(0x08, 1, 64));
+    }
+
+    // Clock stretching: the example target at 0x53 stretches the clock; the target at 0x52 does not.
+    for (auto mode : {Bench::Mode::Cooperative, Bench::Mode::Threaded}) {
+        for (uint8_t address : {0x52, 0x53}) {
+            auto stretching = address == 0x53 ? "true" : "false";
+            bench.run("stretch", {{"stretching", stretching}, {"operation", "\"write\""}}, mode, {0x52, 0x53}, writes(address, 16, 8));
+            bench.run("stretch", {{"stretching", stretching}, {"operation", "\"read\""}}, mode, {0x52, 0x53}, reads(address, 16, 8));
+        }
+    }
+
+    // Sequential reads from a 64 KiB EEPROM image, at edge level and transaction level.
+    const std::string image = path + ".eeprom";
+    for (auto mode : {Bench::Mode::Cooperative, Bench::Mode::Threaded}) {
+        for (auto level : {"edge", "transaction"}) {
+            bench.run<Eeprom>("eeprom", {{"level", "\"" + std::string{level} + "\""}}, mode, {0x50}, reads(0x50, 4, 1024), [&](uint8_t address, Bus * bus)
+            {
+                bus->transaction_level(std::string{level} == "transaction");
+                return std::make_unique<Eeprom>("T" + Log::octet(address), address, bus, Eeprom::M24C512, image);
+            });
+        }
+    }
+    std::remove(image.c_str());
+
+    // SMBus block writes and reads, with and without Packet Error Checking, at edge level and transaction level.
+    for (auto mode : {Bench::Mode::Cooperative, Bench::Mode::Threaded}) {
+        for (auto level : {"edge", "transaction"}) {
+            for (auto pec : {false, true}) {
+                bench.run<SmbusTarget>("smbus", {{"level", "\"" + std::string{level} + "\""}, {"pec", pec ? "true" : "false"}}, mode, {0x40}, smbus_blocks(0x40, 4, pec), [&](uint8_t address, Bus * bus)
+                {
+                    bus->transaction_level(std::string{level} == "transaction");
+                    auto target = std::make_unique<SmbusTarget>("T" + Log::octet(address), address, bus);
+                    target->command(0x30, SmbusTarget::Protocol::Block);
+                    target->pec(pec);
+                    return target;
+                });
+            }
+        }
+    }
+
+    // Throughput versus number of controllers contending for the bus, each writing to its own target.
+    for (auto mode : {Bench::Mode::Cooperative, Bench::Mode::Threaded}) {
+        for (std::size_t n : {1, 2, 4, 8, 16}) {
+            std::atomic<std::size_t> lost{};
+            std::vector<Bench::Workload> workloads{};
+            for (auto address : addresses(n)) {
+                workloads.push_back(contended_writes(address, 48 / n, 8, lost));
+            }
+            bench.run<Target>("contention", {{"controllers", std::to_string(n)}}, mode, addresses(n), workloads, [](uint8_t address, Bus * bus)
+            {
+                return std::make_unique<Target>("T" + Log::octet(address), address, bus);
+            }, [&]
+            {
+                return Bench::Parameters{{"arbitration_lost", std::to_string(lost.load())}};
+            });
+        }
+    }
+
+    // Wait policies of threads, with the workload of the "targets" benchmark (4 targets).  Spinning only pays when
+    // each thread has a processor of its own; otherwise spinning threads wait for each other's time slices, so the
+    // spin policy runs a reduced workload (1 target, 2 writes), which is reported.
+    auto reduced = std::thread::hardware_concurrency() < 5;
+    for (auto [policy, name] : {std::pair{Bus::WaitPolicy::Spin, "\"spin\""}, std::pair{Bus::WaitPolicy::SpinYield, "\"spin_yield\""}, std::pair{Bus::WaitPolicy::Park, "\"park\""}}) {
+        auto shrink = reduced && policy == Bus::WaitPolicy::Spin;
+        std::size_t targets = shrink ? 1 : 4;
+        bench.wait_policy(policy);
+        bench.run("wait_policy", {{"policy", name}, {"targets", std::to_string(targets)}, {"workload", shrink ? "\"reduced\"" : "\"targets\""}}, Bench::Mode::Threaded, addresses(targets), writes(0x08, shrink ? 2 : 20, 8));
+    }
+    bench.wait_policy(Bus::WaitPolicy::Park);
+
+    // Logging enabled versus disabled (messages are written to std::cout).
+    for (auto mode : {Bench::Mode::Cooperative, Bench::Mode::Threaded}) {
+        for (auto [level, name] : {std::pair{Log::Level::Off, "\"off\""}, std::pair{Log::Level::Info, "\"info\""}, std::pair{Log::Level::Debug, "\"debug\""}}) {
+            Log::set_level(level);
+            bench.run("log", {{"level", name}}, mode, addresses(4), writes(0x08, 20, 8));
+            Log::set_level(Log::Level::Off);
+        }
+    }
+
+    bench.write(path);
+}
@@ -1,48 +1,223 @@
 #include "bus.hpp"
 
+#include "detector.hpp"
 #include "line.hpp"
 #include "log.hpp"
 #include "node.hpp"
+#include "monitorinterface.hpp"
+#include "scheduler.hpp"
+#include "transactioninterface.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
-#include <map>
 #include <mutex>
+#include <stdexcept>
 #include <thread>
 #include <vector>
 
+namespace
+{
+
+/// Hint to the processor that the thread is spinning.
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+} // namespace
+
 class Bus::Impl
 {
+    /// A waiting thread spins for SPIN_FACTOR times the average publish time, up to MAX_SPIN (ns).
+    static constexpr uint64_t SPIN_FACTOR = 2;
+    static constexpr uint64_t MAX_SPIN = 50000;
+
+    /// Initial average publish time (ns).
+    static constexpr uint64_t INITIAL_PUBLISH_TIME = 2000;
+
+    /// Number of polls between readings of the clock while spinning.
+    static constexpr unsigned CLOCK_POLLS = 16;
+
+    /// Progress of a waiting thread through the wait policy (see relax()).
+    struct Backoff
+    {
+        /// Number of polls.
+        unsigned polls;
+
+        /// True once the thread has spun for the spin time.
+        bool spun;
+
+        /// End of the spin time, from the first reading of the clock.
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    /// Cooperative scheduler, or nullptr if nodes run on their own threads.
+    Scheduler * scheduler_;
+
+    /// This mutex protects the following member variables.
+    /// @discussion Only taken by the in-flight publisher, and by detach().
+    std::mutex lines_mutex_;
+
     /// Data line.
     Line sda_;
 
     /// Clock line.
     Line scl_;
 
-    /// This mutex protects the following member variables.
-    std::mutex sync_mutex_;
+    /// Decodes changes of the lines into symbols.
+    Detector detector_;
+
+    /// Bus timing.
+    Timing timing_;
+
+    /// Since SCL last changed: a delay was counted as tHIGH, a START was detected, a STOP was detected.
+    bool high_delay_;
+    bool started_;
+    bool stopped_;
+
+    /// True from START to STOP, and the simulated time of the START.
+    bool busy_;
+    uint64_t start_time_;
+
+    /// Snapshot of the line levels, published for lock-free readers.
+    /// @discussion Bit 0 is SDA, bit 1 is SCL, and BUSY is set while the bus is busy.
+    std::atomic<unsigned> levels_;
+
+    /// Bit of levels_ set after a START condition, until a STOP condition.
+    static constexpr unsigned BUSY = 4;
 
     /// Sequence number incremented on every event.
-    uint64_t sequence_;
+    std::atomic<uint64_t> sequence_;
+
+    /// Simulated time (ns), advanced by the publisher.
+    std::atomic<uint64_t> time_;
 
-    struct ClientState
+    /// Condition awaited by a client.
+    struct Condition
+    {
+        /// The condition is satisfied when the levels, masked by @c mask, equal @c value (or differ from @c value if @c equal is false).
+        unsigned mask;
+        unsigned value;
+        bool equal;
+
+        /// If true, the condition is satisfied when a symbol is available instead.
+        bool symbol;
+    };
+
+    /// Number of symbols buffered per client.
+    static constexpr std::size_t SYMBOLS = 64;
+
+    /// Client state, padded to a cache line so that clients do not contend when they advance.
+    struct alignas(64) ClientState
     {
         /// Observed sequence number.
-        uint64_t sequence;
+        /// @discussion Only written by the client thread (or by the publisher for itself).
+        std::atomic<uint64_t> sequence;
 
         /// Pending flag is true if this client is blocked attempting to publish an event.
-        bool pending;
+        std::atomic<bool> pending;
+
+        /// True while a node is attached.
+        std::atomic<bool> attached;
+
+        /// True while the client is parked waiting for a condition.
+        /// @discussion A parked client is not required to synchronize.
+        std::atomic<bool> parked;
+
+        /// True if the client was woken by wake() (and has not yet returned from a wait).
+        std::atomic<bool> woken;
+
+        /// Condition awaited by a waiting client.
+        Condition condition;
+
+        /// Task of a client parked by a cooperative scheduler, woken when the client is unparked.
+        Scheduler::Task * task;
+
+        /// Backoff of the client while it polls lines that have not changed (only used by the client thread).
+        Backoff backoff;
+
+        /// True if the client receives symbols.
+        std::atomic<bool> subscribed;
+
+        /// True if the client only receives the symbols of transactions addressed to it.
+        std::atomic<bool> addressed;
+
+        /// True if the client was addressed in the current transaction (written by the publisher).
+        bool participant;
+
+        /// Single-producer (publisher), single-consumer (client) ring of symbols.
+        std::array<Detector::Symbol, SYMBOLS> symbols;
+
+        /// Index of next symbol to read (written by the client).
+        std::atomic<std::size_t> symbols_head;
+
+        /// Index of next symbol to write (written by the publisher).
+        std::atomic<std::size_t> symbols_tail;
+
+        /// The attached node.
+        const Node * node;
     };
 
-    /// Tracks attached client nodes.
-    std::map<const Node *, ClientState> clients_;
+    /// Number of address slots: 7-bit addresses, then 10-bit addresses.
+    static constexpr std::size_t SLOTS = 128 + 1024;
+
+    /// No client.
+    static constexpr Handle NONE = ~Handle{};
+
+    /// Client subscribed to each address slot, or NONE (protected by lines_mutex_).
+    std::array<Handle, SLOTS> addresses_;
+
+    /// For each value of the upper two bits of a 10-bit address, a client subscribed to such an address (or NONE).
+    /// @discussion This client acknowledges the first octet of a 10-bit address, before the address is complete.
+    std::array<Handle, 4> prefixes_;
+
+    /// Symbols from a START condition to the end of the address, pending delivery to the addressed client.
+    /// @discussion Protected by lines_mutex_.  A 10-bit address comprises the first octet, an ACK bit and the
+    /// second octet.  The length is 0 outside the address.
+    std::array<Detector::Symbol, 18> address_symbols_;
+    std::size_t address_length_;
+
+    /// Address octets received so far.
+    unsigned address_first_;
+    unsigned address_second_;
+
+    /// Client that acknowledges the first octet of a 10-bit address, if it joined the transaction to do so.
+    Handle representative_;
+
+    /// Number of client slots.
+    std::size_t capacity_;
+
+    /// Tracks attached client nodes, indexed by handle.
+    /// @discussion The handle is also the slot index of the node on the lines.
+    std::unique_ptr<ClientState[]> clients_;
+
+    /// Number of slots that have ever been attached.
+    /// @discussion Attached clients are found by a linear sweep of slots below this limit.
+    std::atomic<std::size_t> used_;
+
+    /// This mutex protects the following member variables.
+    std::mutex attach_mutex_;
+
+    /// Slots released by detached nodes.
+    std::vector<Handle> free_slots_;
+
+    /// This mutex protects the following member variables.
+    std::mutex queue_mutex_;
 
     /// Tracks the in-flight event publisher.
-    const Node * publisher_;
+    std::atomic<const Node *> publisher_;
 
     struct Transaction
     {
         /// The node that wants to publish.
-        const Node * node;
+        Handle handle;
 
         /// The event.
         Event event;
@@ -51,121 +226,743 @@ class Bus::Impl
     /// Tracks the set of events that are waiting to be published.
     std::vector<Transaction> queue_;
 
+    /// This mutex is only used by threads that park (after spinning) and by the threads that wake them.
+    std::mutex park_mutex_;
+
+    /// True while the publisher is parked on sync_condition_.
+    std::atomic<bool> publisher_parked_;
+
+    /// Number of pending publishers parked on pending_condition_.
+    std::atomic<int> pending_parked_;
+
+    /// Number of clients parked on wait_condition_.
+    std::atomic<int> waiters_parked_;
+
+    /// How threads wait.
+    std::atomic<WaitPolicy> wait_policy_;
+
+    /// True if threads may run in parallel, so that spinning threads do not hold up other threads.
+    const bool multiprocessor_;
+
+    /// Moving average of the time (ns) of a publish, from claiming the queue to the last synchronization.
+    /// @discussion Written by the publisher.
+    std::atomic<uint64_t> publish_time_;
+
+    /// Counters.
+    std::atomic<uint64_t> events_;
+    std::atomic<uint64_t> coalesced_;
+    std::atomic<uint64_t> pending_waits_;
+    std::atomic<uint64_t> parks_;
+    std::atomic<uint64_t> wakeups_;
+    std::atomic<uint64_t> sync_failures_;
+    std::atomic<uint64_t> reset_time_;
+    std::atomic<uint64_t> busy_time_;
+
+    /// Histogram buckets, written by one client.
+    using Buckets = std::array<std::atomic<uint64_t>, Histogram::BUCKETS>;
+
+    /// Latency histograms of a client.
+    struct Latency
+    {
+        Buckets publish;
+        Buckets sync;
+    };
+
+    /// Simulated transaction durations.
+    Buckets transactions_;
+
+    /// True if latency histograms are enabled.
+    std::atomic<bool> latency_enabled_;
+
+    /// Latency histograms indexed by handle, allocated when first enabled.
+    std::unique_ptr<Latency[]> latency_;
+
+    /// Records the duration of its scope to a histogram, if enabled.
+    class Timer
+    {
+        Buckets * buckets_;
+        std::chrono::steady_clock::time_point start_;
+
+    public:
+        explicit Timer(Buckets * buckets) : buckets_{buckets}, start_{buckets ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{}}
+        {
+        }
+
+        Timer(const Timer &) = delete;
+        Timer & operator=(const Timer &) = delete;
+
+        ~Timer()
+        {
+            if (buckets_) {
+                auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+                count((*buckets_)[Histogram::bucket(static_cast<uint64_t>(elapsed))]);
+            }
+        }
+    };
+
+    /// @return Timer Timer for the histogram of @c handle selected by @c member.
+    Timer time(Handle handle, Buckets Latency::* member)
+    {
+        return Timer{latency_enabled_.load(std::memory_order_acquire) ? &(latency_[handle].*member) : nullptr};
+    }
+
+    /// Increment a counter.
+    static void count(std::atomic<uint64_t> & counter, uint64_t n = 1)
+    {
+        counter.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    static void clear(Buckets & buckets)
+    {
+        for (auto & bucket : buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    static void clear(Latency & latency)
+    {
+        clear(latency.publish);
+        clear(latency.sync);
+    }
+
+    static void copy(const Buckets & buckets, Histogram & histogram)
+    {
+        for (std::size_t i = 0; i < Histogram::BUCKETS; ++i) {
+            auto n = buckets[i].load(std::memory_order_relaxed);
+            if (n) {
+                histogram.record(Histogram::lowest(i), n);
+            }
+        }
+    }
+
     /// Used to detect that client threads have observed an event.
     std::condition_variable sync_condition_;
 
     /// Used to wake up pending clients after an on-going transaction completes.
     std::condition_variable pending_condition_;
 
+    /// Used to wake up clients that wait for a condition.
+    std::condition_variable wait_condition_;
+
+    /// True if transaction-level simulation is enabled.
+    std::atomic<bool> transaction_level_;
+
+    /// Monitors, protected by lines_mutex_.
+    std::vector<MonitorInterface *> monitors_;
+
+    /// This mutex protects the following member variables.
+    std::mutex targets_mutex_;
+
+    /// Target that supports transaction-level simulation at each address slot, or nullptr.
+    std::array<TransactionInterface *, SLOTS> targets_;
+
     /// Process an event by updating the bus state.
     void process(const Transaction & transaction)
     {
         switch (transaction.event) {
             case Event::DataLow:
-                sda_.set(transaction.node, Line::Level::Low);
+                sda_.set(transaction.handle, Line::Level::Low);
                 break;
             case Event::DataHigh:
-                sda_.set(transaction.node, Line::Level::High);
+                sda_.set(transaction.handle, Line::Level::High);
                 break;
             case Event::ClockLow:
-                scl_.set(transaction.node, Line::Level::Low);
+                scl_.set(transaction.handle, Line::Level::Low);
                 break;
             case Event::ClockHigh:
-                scl_.set(transaction.node, Line::Level::High);
+                scl_.set(transaction.handle, Line::Level::High);
                 break;
             case Event::Delay:
                 break;
         }
     }
 
+    /// Advance the simulated time for an event.
+    /// @discussion Caller must hold lines_mutex_.
+    /// @param scl The SCL level before the event.
+    void tick(Event event, Line::Level scl)
+    {
+        auto time = time_.load(std::memory_order_relaxed);
+
+        if (scl != scl_.get()) {
+            time += scl == Line::Level::Low ? timing_.rise : timing_.fall;
+            high_delay_ = started_ = stopped_ = false;
+        } else if (event == Event::Delay) {
+            if (scl == Line::Level::Low) {
+                time += timing_.low;
+            } else if (stopped_) {
+                time += timing_.buf;
+            } else if (started_) {
+                time += timing_.hd_sta;
+            } else {
+                // Not known to be a set-up time until SDA changes.
+                time += timing_.high;
+                high_delay_ = true;
+            }
+        }
+
+        time_.store(time, std::memory_order_relaxed);
+    }
+
+    /// Adjust the simulated time for a symbol, and time transactions.
+    /// @discussion Caller must hold lines_mutex_.
+    void tick(Detector::Symbol symbol)
+    {
+        auto time = time_.load(std::memory_order_relaxed);
+
+        switch (symbol) {
+            case Detector::Symbol::Start:
+            case Detector::Symbol::RepeatedStart:
+                if (high_delay_) {
+                    // The delay while SCL was high was a set-up time.
+                    time = time - timing_.high + timing_.su_sta;
+                }
+                started_ = true;
+                if (!busy_) {
+                    busy_ = true;
+                    start_time_ = time;
+                }
+                break;
+
+            case Detector::Symbol::Stop:
+                if (high_delay_) {
+                    time = time - timing_.high + timing_.su_sto;
+                }
+                stopped_ = true;
+                if (busy_) {
+                    busy_ = false;
+                    count(busy_time_, time - start_time_);
+                    count(transactions_[Histogram::bucket(time - start_time_)]);
+                }
+                break;
+
+            default:
+                return;
+        }
+
+        high_delay_ = false;
+        time_.store(time, std::memory_order_relaxed);
+    }
+
+    /// Publish the line levels to lock-free readers.
+    void store_levels()
+    {
+        levels_ = encode(sda_.get(), scl_.get()) | (detector_.busy() ? BUSY : 0U);
+    }
+
+    /// Spin once.
+    /// @discussion On a uniprocessor, the thread that is awaited cannot run while this thread spins.
+    void spin()
+    {
+        if (multiprocessor_) {
+            cpu_relax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    /// Relax while waiting for another client.
+    /// @discussion Cooperative tasks yield to the scheduler.  Threads spin, for about as long as a publish takes
+    /// (unless the policy is to spin indefinitely), then yield the processor or park, according to the policy.
+    /// @param backoff The progress of the wait, initially zero.
+    /// @return bool False if the caller should park.
+    bool relax(Backoff & backoff)
+    {
+        if (scheduler_) {
+            scheduler_->yield();
+            return true;
+        }
+
+        auto policy = wait_policy_.load(std::memory_order_relaxed);
+        if (policy == WaitPolicy::Spin) {
+            cpu_relax();
+            return true;
+        }
+
+        if (!backoff.spun) {
+            // Reading the clock costs more than a poll, and most waits are shorter than CLOCK_POLLS polls.
+            if (++backoff.polls % CLOCK_POLLS != 0) {
+                spin();
+                return true;
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (backoff.polls == CLOCK_POLLS) {
+                auto time = std::min(SPIN_FACTOR * publish_time_.load(std::memory_order_relaxed), MAX_SPIN);
+                backoff.deadline = now + std::chrono::nanoseconds(time);
+            }
+            if (now < backoff.deadline) {
+                spin();
+                return true;
+            }
+            backoff.spun = true;
+        }
+
+        if (policy == WaitPolicy::SpinYield) {
+            std::this_thread::yield();
+            return true;
+        }
+
+        return false;
+    }
+
+    /// @discussion Advance the client by at most one sequence number, and wake a parked publisher.
+    void advance(ClientState & client)
+    {
+        auto sequence = client.sequence.load(std::memory_order_relaxed);
+        if (sequence < sequence_.load()) {
+            client.sequence.store(sequence + 1);
+
+            // Notify waiting publisher.
+            if (publisher_parked_.load()) {
+                std::lock_guard<std::mutex> lock(park_mutex_);
+                sync_condition_.notify_one();
+                count(wakeups_);
+            }
+        }
+    }
+
     /// @discussion Called by client threads to synchronize with current state.
     /// @return Line::Level SDA level
     /// @return Line::Level SCL level
-    std::tuple<Line::Level, Line::Level> sync(const Node * node)
+    std::tuple<Line::Level, Line::Level> sync(Handle handle)
     {
-        std::unique_lock<std::mutex> lock(sync_mutex_);
-        locked_sync(node);
+        return decode(observe(clients_[handle]));
+    }
 
-        return {sda_.get(), scl_.get()};
+    /// @return unsigned Line levels, after advancing the client.
+    unsigned observe(ClientState & client)
+    {
+        advance(client);
+        return levels_.load();
     }
 
-    void locked_sync(const Node * node)
+    /// @return Line::Level SDA level
+    /// @return Line::Level SCL level
+    static std::tuple<Line::Level, Line::Level> decode(unsigned levels)
     {
-        if (clients_[node].sequence < sequence_) {
-            // Advance.
-            clients_[node].sequence++;
+        return {(levels & 1) ? Line::Level::High : Line::Level::Low, (levels & 2) ? Line::Level::High : Line::Level::Low};
+    }
 
-            // Notify waiting publisher.
-            sync_condition_.notify_one();
-        }
+    /// @return unsigned Line levels encoded as for levels_.
+    static unsigned encode(Line::Level sda, Line::Level scl)
+    {
+        return (sda == Line::Level::High ? 1U : 0U) | (scl == Line::Level::High ? 2U : 0U);
     }
 
-    /// @discussion Called when a thread is awoken by one of the two condition variables.
     /// @return bool True if all client threads are synchronized.
-    bool all_clients_synchronized() const
+    bool all_clients_synchronized()
     {
-        for (auto const & client : clients_) {
-            if (client.second.sequence != sequence_) {
+        auto sequence = sequence_.load();
+        auto used = used_.load();
+        for (std::size_t handle = 0; handle < used; ++handle) {
+            auto const & client = clients_[handle];
+            if (client.sequence.load() != sequence && client.attached.load() && !client.parked.load()) {
+                count(sync_failures_);
                 return false;
             }
         }
         return true;
     }
 
-    /// @discussion Publish a state change and wait for all other clients to observe that change.
-    void publish(const Node * node, Event event)
+    /// @discussion Wait for all clients to synchronize: spin first, then park until woken by advance().
+    /// Cooperative tasks yield instead: the clients that have not synchronized are runnable tasks.
+    void await_clients()
     {
-        std::unique_lock<std::mutex> lock(sync_mutex_);
-        queue_.push_back({node, event});
+        for (Backoff backoff{}; ; ) {
+            if (all_clients_synchronized()) {
+                return;
+            }
+            if (!relax(backoff)) {
+                break;
+            }
+        }
 
-        if (publisher_) {
-            // This thread may gain the lock -- but find that another thread is busy publishing.
-            // This happens when (a) two threads race to publish and (b) when this thread wants
-            // to publish in response to an event currently being published by another thread.
+        std::unique_lock<std::mutex> lock(park_mutex_);
+        count(parks_);
+        publisher_parked_ = true;
+        sync_condition_.wait(lock, [&]{
+            return all_clients_synchronized();
+        });
+        publisher_parked_ = false;
+    }
 
-            // We are pending: we have something to publish.
-            clients_[node].pending = true;
+    /// @discussion Wake pending publishers, if any are parked.
+    void wake_pending()
+    {
+        if (pending_parked_.load() > 0) {
+            std::lock_guard<std::mutex> lock(park_mutex_);
+            pending_condition_.notify_all();
+            count(wakeups_);
+        }
+    }
 
-            // Note that if multiple publishers are blocked, then once it is possible to publish,
-            // the first publisher that gains the lock will handle *all* queued requests.
-            // This behaviour keeps all client threads in sync.
+    /// @return bool True if the client's condition is satisfied by @c levels.
+    static bool satisfied(const ClientState & client, unsigned levels)
+    {
+        const auto & condition = client.condition;
+        if (condition.symbol) {
+            return client.symbols_head.load() != client.symbols_tail.load();
+        }
+        return ((levels & condition.mask) == condition.value) == condition.equal;
+    }
 
-            while (publisher_) {
-                pending_condition_.wait(lock, [&]{
-                    // If our state change was processed, then return to normal processing.
-                    if (!clients_[node].pending) {
-                        return true;
-                    }
+    /// Append a symbol to the ring of a client.
+    /// @discussion Symbols are dropped if the client does not keep up.
+    static void push(ClientState & client, Detector::Symbol symbol)
+    {
+        auto tail = client.symbols_tail.load(std::memory_order_relaxed);
+        if (tail - client.symbols_head.load() < SYMBOLS) {
+            client.symbols[tail % SYMBOLS] = symbol;
+            client.symbols_tail.store(tail + 1);
+        }
+    }
 
-                    // Call sync() (with lock held) to allow other publisher to succeed.
-                    locked_sync(node);
+    /// Deliver a symbol to subscribed clients (of those subscribed by address, only participants).
+    /// @discussion Called by the publisher.
+    void deliver(Detector::Symbol symbol)
+    {
+        auto used = used_.load();
+        for (std::size_t handle = 0; handle < used; ++handle) {
+            auto & client = clients_[handle];
+            if (client.subscribed.load() && (client.participant || !client.addressed.load())) {
+                push(client, symbol);
+            }
+        }
+    }
+
+    /// @return std::size_t The address slot of a 7-bit address, or of a 10-bit address flagged with TEN_BIT.
+    /// @discussion Throws @c std::out_of_range if the address is invalid.
+    static std::size_t slot(uint16_t address)
+    {
+        if ((address & ~0x3FFU) == TEN_BIT) {
+            return 128 + (address & 0x3FFU);
+        }
+        if (address >= 128) {
+            throw std::out_of_range("invalid address");
+        }
+        return address;
+    }
+
+    /// Dispatch a symbol.
+    /// @discussion Called by the publisher, holding lines_mutex_.
+    /// The address is decoded once: the START condition and address symbols are withheld from clients subscribed
+    /// by address until the address is complete, then delivered to the addressed client only, which participates
+    /// (receiving all symbols) until the STOP condition.
+    void dispatch(Detector::Symbol symbol)
+    {
+        deliver(symbol);
 
-                    // Proceed when not busy.
-                    return !publisher_;
-                });
+        switch (symbol) {
+            case Detector::Symbol::Start:
+            case Detector::Symbol::RepeatedStart:
+                address_symbols_[0] = symbol;
+                address_length_ = 1;
+                address_first_ = 0;
+                address_second_ = 0;
+                representative_ = NONE;
+                break;
 
-                if (!clients_[node].pending) {
-                    // Our state change was published by another thread.  Nothing more to do.
-                    return;
+            case Detector::Symbol::Bit0:
+            case Detector::Symbol::Bit1:
+                if (address_length_) {
+                    address(symbol);
                 }
-            }
+                break;
 
-            if (queue_.empty()) {
-                // Queue emptied by another thread.  Nothing more to do.
+            case Detector::Symbol::Stop:
+                address_length_ = 0;
+                for (std::size_t handle = 0, used = used_.load(); handle < used; ++handle) {
+                    clients_[handle].participant = false;
+                }
+                break;
+
+            case Detector::Symbol::None:
+                break;
+        }
+    }
+
+    /// Decode a bit of the address.
+    void address(Detector::Symbol symbol)
+    {
+        address_symbols_[address_length_++] = symbol;
+        auto bit = symbol == Detector::Symbol::Bit1 ? 1U : 0U;
+
+        if (address_length_ <= 9) {
+            address_first_ = address_first_ << 1 | bit;
+            if (address_length_ < 9) {
                 return;
             }
+
+            if ((address_first_ & 0xF8) != 0xF0) {
+                // 7-bit address.
+                join(addresses_[address_first_ >> 1]);
+                address_length_ = 0;
+            } else if (address_first_ & 1) {
+                // 10-bit read: the target addressed by the preceding 10-bit write already participates.
+                address_length_ = 0;
+            } else {
+                // 10-bit write: a target whose address has the same upper two bits acknowledges the first octet.
+                auto representative = prefixes_[address_first_ >> 1 & 3];
+                representative_ = join(representative) ? representative : NONE;
+            }
+        } else if (address_length_ > 10) {
+            // Second octet of a 10-bit address (after the ACK bit).
+            address_second_ = address_second_ << 1 | bit;
+            if (address_length_ == address_symbols_.size()) {
+                auto handle = addresses_[slot(static_cast<uint16_t>(TEN_BIT | (address_first_ & 6) << 7 | address_second_))];
+                if (representative_ != NONE && representative_ != handle) {
+                    clients_[representative_].participant = false;
+                }
+                join(handle);
+                address_length_ = 0;
+            }
+        }
+    }
+
+    /// Deliver the withheld symbols to an addressed client, which participates from now on.
+    /// @return bool True if the client joined (rather than already participating).
+    bool join(Handle handle)
+    {
+        if (handle == NONE || clients_[handle].participant) {
+            return false;
+        }
+
+        auto & client = clients_[handle];
+        client.participant = true;
+        for (std::size_t i = 0; i < address_length_; ++i) {
+            push(client, address_symbols_[i]);
+        }
+        return true;
+    }
+
+    /// @discussion Caller must hold park_mutex_.
+    void locked_unpark(ClientState & client)
+    {
+        // The client must synchronize (once) with the current sequence number, like any other client.
+        client.sequence = sequence_.load();
+        client.parked = false;
+        waiters_parked_--;
+
+        if (client.task) {
+            scheduler_->wake(client.task);
+            client.task = nullptr;
+        }
+    }
+
+    /// @discussion Called by the publisher after updating the line levels.
+    void wake_waiters()
+    {
+        if (waiters_parked_.load() == 0) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(park_mutex_);
+        auto levels = levels_.load();
+        auto used = used_.load();
+        auto woken = false;
+        for (std::size_t handle = 0; handle < used; ++handle) {
+            auto & client = clients_[handle];
+            if (client.parked.load() && satisfied(client, levels)) {
+                locked_unpark(client);
+                woken = true;
+            }
+        }
+
+        if (woken) {
+            wait_condition_.notify_all();
+            count(wakeups_);
+        }
+    }
+
+    /// @discussion Wait until a condition is satisfied: spin first, then park until woken by the publisher.
+    /// Cooperative tasks park at once, and block until woken, so that they are not resumed meanwhile.
+    /// A parked client unparks itself at @c deadline.
+    std::tuple<Line::Level, Line::Level> wait(Handle handle, const Condition & condition, std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max())
+    {
+        auto timer = time(handle, &Latency::sync);
+        auto & self = clients_[handle];
+        self.condition = condition;
+
+        for (Backoff backoff{}; ; ) {
+            auto levels = observe(self);
+            if (satisfied(self, levels) || self.woken.exchange(false)) {
+                return decode(levels);
+            }
+
+            if (!scheduler_ && relax(backoff)) {
+                continue;
+            }
+
+            auto expired = [&]{
+                return deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() >= deadline;
+            };
+
+            std::unique_lock<std::mutex> lock(park_mutex_);
+            count(parks_);
+            waiters_parked_++;
+            self.parked = true;
+
+            if (satisfied(self, levels_.load()) || self.woken.load()) {
+                // Changed while parking.
+                self.parked = false;
+                waiters_parked_--;
+            } else if (scheduler_) {
+                self.task = scheduler_->current();
+                while (self.parked.load() && !expired()) {
+                    lock.unlock();
+                    scheduler_->block(deadline);
+                    lock.lock();
+                }
+            } else {
+                // The publisher no longer waits for this client.
+                if (publisher_parked_.load()) {
+                    sync_condition_.notify_one();
+                    count(wakeups_);
+                }
+
+                auto unparked = [&]{
+                    return !self.parked.load();
+                };
+                if (deadline == std::chrono::steady_clock::time_point::max()) {
+                    wait_condition_.wait(lock, unparked);
+                } else {
+                    wait_condition_.wait_until(lock, deadline, unparked);
+                }
+            }
+
+            if (self.parked.load()) {
+                // The deadline passed.
+                self.task = nullptr;
+                locked_unpark(self);
+                lock.unlock();
+                return decode(observe(self));
+            }
+
+            backoff = {};
+        }
+    }
+
+    /// @discussion Attempt to become the publisher.
+    /// Caller must hold queue_mutex_.
+    /// @return bool True if this thread is now the publisher and has taken the queue.
+    bool locked_claim(const Node * node, std::vector<Transaction> & snapshot)
+    {
+        if (publisher_.load()) {
+            return false;
         }
 
         // Transaction begins.
         publisher_ = node;
+        snapshot = std::move(queue_);
+        return true;
+    }
 
-        auto snapshot = std::move(queue_);
-        for (const auto & transaction : snapshot) {
-            // Update state.
-            process(transaction);
+    /// @discussion Called while another thread is publishing.
+    /// Keep this client synchronized (so that the other publisher can succeed) until either our state change
+    /// was processed by the other publisher, or the other publisher finishes and this thread can publish.
+    /// @return bool True if this thread is now the publisher and has taken the queue.
+    bool await_publisher(const Node * node, ClientState & self, std::vector<Transaction> & snapshot)
+    {
+        auto ready = [&]{
+            return !self.pending.load() || !publisher_.load() || self.sequence.load(std::memory_order_relaxed) < sequence_.load();
+        };
+
+        for (Backoff backoff{}; ; ) {
+            if (!self.pending.load()) {
+                // Our state change was published by another thread.  Nothing more to do.
+                return false;
+            }
+
+            // Synchronize to allow other publisher to succeed.
+            advance(self);
+
+            if (!publisher_.load()) {
+                std::lock_guard<std::mutex> lock(queue_mutex_);
+                if (!self.pending.load()) {
+                    return false;
+                }
+                if (locked_claim(node, snapshot)) {
+                    return true;
+                }
+            }
+
+            if (!relax(backoff)) {
+                std::unique_lock<std::mutex> lock(park_mutex_);
+                count(parks_);
+                pending_parked_++;
+                pending_condition_.wait(lock, ready);
+                pending_parked_--;
+            }
+        }
+    }
+
+    /// @discussion Publish a state change and wait for all other clients to observe that change.
+    void publish(Handle handle, Event event)
+    {
+        auto & self = clients_[handle];
+        auto node = self.node;
+
+        std::vector<Transaction> snapshot;
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            queue_.push_back({handle, event});
+
+            if (!locked_claim(node, snapshot)) {
+                // This thread finds that another thread is busy publishing.
+                // This happens when (a) two threads race to publish and (b) when this thread wants
+                // to publish in response to an event currently being published by another thread.
+
+                // We are pending: we have something to publish.
+                self.pending = true;
+                count(pending_waits_);
+            }
+        }
+
+        // Note that if multiple publishers are blocked, then once it is possible to publish,
+        // the first publisher that claims the queue will handle *all* queued requests.
+        // This behaviour keeps all client threads in sync.
+        if (self.pending.load() && !await_publisher(node, self, snapshot)) {
+            return;
+        }
+
+        auto begun = std::chrono::steady_clock::now();
+
+        {
+            std::lock_guard<std::mutex> lock(lines_mutex_);
+            for (const auto & transaction : snapshot) {
+                // Update state.
+                auto scl = scl_.get();
+                process(transaction);
+                tick(transaction.event, scl);
+
+                // A START or STOP condition adjusts the simulated time of its set-up.
+                auto symbol = detector_.update(sda_.get(), scl_.get());
+                if (symbol != Detector::Symbol::None) {
+                    tick(symbol);
+                }
+
+                for (auto monitor : monitors_) {
+                    monitor->event(sequence_.load(), time_.load(std::memory_order_relaxed), transaction.handle, clients_[transaction.handle].node, transaction.event, sda_.get(), scl_.get());
+                }
+
+                if (symbol != Detector::Symbol::None) {
+                    dispatch(symbol);
+                }
+            }
+
+            store_levels();
+        }
+
+        count(events_, snapshot.size());
+        count(coalesced_, snapshot.size() - 1);
+
+        // Parked clients whose condition is now satisfied must observe the new state.
+        wake_waiters();
 
+        for (const auto & transaction : snapshot) {
             // The client state has been acted upon, and is no longer pending.
-            clients_[transaction.node].pending = false;
+            clients_[transaction.handle].pending = false;
         }
 
         // Wait for threads to synchronize *twice*.
@@ -174,79 +971,513 @@ class Bus::Impl
 
         for (auto i = 1; i <= 2; ++i) {
             // Advance, since we have updated the state.
-            sequence_++;
+            auto sequence = ++sequence_;
 
             // Synchronize sequence number manually since node is blocked in publish().
-            clients_[node].sequence = sequence_;
+            self.sequence = sequence;
 
             // Pending publishers implicitly see the new state.
-            pending_condition_.notify_all();
+            wake_pending();
 
             // Wait for threads to observe the new state via a call to sync().
-            sync_condition_.wait(lock, [&]{
-                // Proceed when all clients are synchronized.
-                return all_clients_synchronized();
-            });
+            await_clients();
         }
 
-        // Transaction complete.
-        publisher_ = nullptr;
+        // Waiting threads spin for about as long as a publish takes.
+        auto elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begun).count());
+        publish_time_.store((publish_time_.load(std::memory_order_relaxed) * 7 + elapsed) / 8, std::memory_order_relaxed);
+
+        {
+            // Transaction complete.
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            publisher_ = nullptr;
+        }
 
         // Notify pending publisher threads.
-        pending_condition_.notify_all();
+        wake_pending();
+
+        // A task that only publishes (such as a node delaying while it holds SCL low) must not starve the others.
+        if (scheduler_) {
+            scheduler_->relinquish();
+        }
     }
 
 public:
-    Impl() : sda_{}, scl_{}, sync_mutex_{}, sequence_{}, clients_{}, publisher_{}, queue_{}, sync_condition_{}, pending_condition_{}
+    Impl(Scheduler * scheduler, std::size_t capacity) : scheduler_{scheduler}, lines_mutex_{}, sda_{}, scl_{}, detector_{}, timing_{STANDARD_MODE}, high_delay_{}, started_{}, stopped_{}, busy_{}, start_time_{}, levels_{3}, sequence_{}, time_{}, addresses_{}, prefixes_{}, address_symbols_{}, address_length_{}, address_first_{}, address_second_{}, representative_{NONE}, capacity_{capacity}, clients_{std::make_unique<ClientState[]>(capacity)}, used_{}, attach_mutex_{}, free_slots_{}, queue_mutex_{}, publisher_{}, queue_{}, park_mutex_{}, publisher_parked_{}, pending_parked_{}, waiters_parked_{}, wait_policy_{WaitPolicy::Park}, multiprocessor_{std::thread::hardware_concurrency() > 1}, publish_time_{INITIAL_PUBLISH_TIME}, events_{}, coalesced_{}, pending_waits_{}, parks_{}, wakeups_{}, sync_failures_{}, reset_time_{}, busy_time_{}, transactions_{}, latency_enabled_{}, latency_{}, sync_condition_{}, pending_condition_{}, wait_condition_{}, transaction_level_{}, monitors_{}, targets_mutex_{}, targets_{}
     {
+        addresses_.fill(NONE);
+        prefixes_.fill(NONE);
+        targets_.fill(nullptr);
+        sda_.reserve(capacity_);
+        scl_.reserve(capacity_);
+        clear(transactions_);
     }
 
-    void attach(const Node * node)
+    Handle attach(const Node * node)
     {
-        std::unique_lock<std::mutex> lock(sync_mutex_);
-        clients_[node] = {};
+        std::lock_guard<std::mutex> lock(attach_mutex_);
+
+        Handle handle;
+        if (!free_slots_.empty()) {
+            handle = free_slots_.back();
+            free_slots_.pop_back();
+        } else if (used_ < capacity_) {
+            handle = used_;
+        } else {
+            throw std::length_error("bus capacity exceeded");
+        }
+
+        auto & client = clients_[handle];
+        client.node = node;
+        client.pending = false;
+        client.parked = false;
+        client.woken = false;
+        client.task = nullptr;
+        client.backoff = {};
+        client.subscribed = false;
+        client.addressed = false;
+        client.participant = false;
+        client.symbols_head = 0;
+        client.symbols_tail = 0;
+        client.sequence = sequence_.load();
+        if (latency_) {
+            clear(latency_[handle]);
+        }
+        client.attached = true;
+
+        if (handle == used_) {
+            used_++;
+        }
+
+        return handle;
     }
 
-    void detach(const Node * node)
+    void detach(Handle handle)
     {
-        std::unique_lock<std::mutex> lock(sync_mutex_);
-        clients_.erase(node);
+        std::lock_guard<std::mutex> lock(attach_mutex_);
+        clients_[handle].attached = false;
+
+        {
+            // Release the lines, so that the slot may be reused.
+            std::lock_guard<std::mutex> lines(lines_mutex_);
+            sda_.set(handle, Line::Level::High);
+            scl_.set(handle, Line::Level::High);
+            store_levels();
+
+            std::replace(addresses_.begin(), addresses_.end(), handle, NONE);
+            for (std::size_t prefix = 0; prefix < prefixes_.size(); ++prefix) {
+                if (prefixes_[prefix] == handle) {
+                    // Another target with the same upper two address bits acknowledges the first octet.
+                    auto first = addresses_.begin() + static_cast<std::ptrdiff_t>(slot(static_cast<uint16_t>(TEN_BIT | prefix << 8)));
+                    auto other = std::find_if(first, first + 256, [](Handle entry) { return entry != NONE; });
+                    prefixes_[prefix] = other != first + 256 ? *other : NONE;
+                }
+            }
+            clients_[handle].subscribed = false;
+            clients_[handle].participant = false;
+        }
+
+        // Released lines may satisfy parked clients, and the publisher no longer waits for this client.
+        wake_waiters();
+        if (publisher_parked_.load()) {
+            std::lock_guard<std::mutex> lock(park_mutex_);
+            sync_condition_.notify_one();
+            count(wakeups_);
+        }
+
+        free_slots_.push_back(handle);
+    }
+
+    void attach(TransactionInterface * target, uint16_t address)
+    {
+        auto index = slot(address);
+        std::lock_guard<std::mutex> lock(targets_mutex_);
+        if (targets_[index] && targets_[index] != target) {
+            throw std::invalid_argument("address in use");
+        }
+        targets_[index] = target;
+    }
+
+    void detach(TransactionInterface * target)
+    {
+        std::lock_guard<std::mutex> lock(targets_mutex_);
+        std::replace(targets_.begin(), targets_.end(), target, static_cast<TransactionInterface *>(nullptr));
     }
 
-    std::tuple<Line::Level, Line::Level> get(const Node * node)
+    TransactionInterface * target(uint16_t address)
     {
-        std::this_thread::yield();
-        return sync(node);
+        auto index = slot(address);
+        std::lock_guard<std::mutex> lock(targets_mutex_);
+        return targets_[index];
     }
 
-    void set(const Node * node, Event event)
+    void transaction_level(bool enable)
     {
-        publish(node, event);
+        transaction_level_ = enable;
+    }
+
+    bool transaction_level() const
+    {
+        return transaction_level_;
+    }
+
+    void timing(const Timing & timing)
+    {
+        std::lock_guard<std::mutex> lock(lines_mutex_);
+        timing_ = timing;
+    }
+
+    Timing timing()
+    {
+        std::lock_guard<std::mutex> lock(lines_mutex_);
+        return timing_;
+    }
+
+    uint64_t time() const
+    {
+        return time_.load(std::memory_order_relaxed);
+    }
+
+    void latency_histograms(bool enable)
+    {
+        std::lock_guard<std::mutex> lock(attach_mutex_);
+        if (enable && !latency_) {
+            latency_ = std::make_unique<Latency[]>(capacity_);
+            for (std::size_t handle = 0; handle < capacity_; ++handle) {
+                clear(latency_[handle]);
+            }
+        }
+        latency_enabled_.store(enable, std::memory_order_release);
+    }
+
+    bool latency_histograms() const
+    {
+        return latency_enabled_;
+    }
+
+    Statistics statistics()
+    {
+        Statistics statistics{};
+        statistics.events = events_.load(std::memory_order_relaxed);
+        statistics.coalesced = coalesced_.load(std::memory_order_relaxed);
+        statistics.pending_waits = pending_waits_.load(std::memory_order_relaxed);
+        statistics.parks = parks_.load(std::memory_order_relaxed);
+        statistics.wakeups = wakeups_.load(std::memory_order_relaxed);
+        statistics.sync_failures = sync_failures_.load(std::memory_order_relaxed);
+        statistics.publish_time = publish_time_.load(std::memory_order_relaxed);
+        statistics.time = time_.load(std::memory_order_relaxed) - reset_time_.load(std::memory_order_relaxed);
+        statistics.busy = busy_time_.load(std::memory_order_relaxed);
+        copy(transactions_, statistics.transactions);
+
+        std::lock_guard<std::mutex> lock(attach_mutex_);
+        if (latency_enabled_.load()) {
+            auto used = used_.load();
+            for (std::size_t handle = 0; handle < used; ++handle) {
+                if (!clients_[handle].attached.load()) {
+                    continue;
+                }
+
+                Statistics::Latency latency{clients_[handle].node, {}, {}};
+                copy(latency_[handle].publish, latency.publish);
+                copy(latency_[handle].sync, latency.sync);
+                statistics.latency.push_back(latency);
+            }
+        }
+        return statistics;
+    }
+
+    void reset_statistics()
+    {
+        for (auto counter : {&events_, &coalesced_, &pending_waits_, &parks_, &wakeups_, &sync_failures_, &busy_time_}) {
+            counter->store(0, std::memory_order_relaxed);
+        }
+        reset_time_.store(time_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        clear(transactions_);
+
+        std::lock_guard<std::mutex> lock(attach_mutex_);
+        if (latency_) {
+            for (std::size_t handle = 0; handle < capacity_; ++handle) {
+                clear(latency_[handle]);
+            }
+        }
+    }
+
+    void attach(MonitorInterface * monitor)
+    {
+        std::lock_guard<std::mutex> lock(lines_mutex_);
+        monitors_.push_back(monitor);
+    }
+
+    void detach(MonitorInterface * monitor)
+    {
+        std::lock_guard<std::mutex> lock(lines_mutex_);
+        monitors_.erase(std::remove(monitors_.begin(), monitors_.end(), monitor), monitors_.end());
+    }
+
+    std::tuple<Line::Level, Line::Level> get(Handle handle)
+    {
+        auto timer = time(handle, &Latency::sync);
+        auto & self = clients_[handle];
+
+        // A client that polls lines that cannot have changed since it last synchronized backs off, so that the
+        // nodes that change them can run; otherwise it synchronizes at once.
+        if (self.sequence.load(std::memory_order_relaxed) == sequence_.load()) {
+            if (!relax(self.backoff)) {
+                std::this_thread::yield();
+            }
+        } else {
+            self.backoff = {};
+        }
+        return sync(handle);
+    }
+
+    void wait_policy(WaitPolicy policy)
+    {
+        wait_policy_ = policy;
+    }
+
+    WaitPolicy wait_policy() const
+    {
+        return wait_policy_;
+    }
+
+    bool busy(Handle handle)
+    {
+        auto timer = time(handle, &Latency::sync);
+        return (observe(clients_[handle]) & BUSY) != 0;
+    }
+
+    void wait_for_idle(Handle handle, std::chrono::steady_clock::time_point deadline)
+    {
+        wait(handle, {BUSY, 0U, true, false}, deadline);
+    }
+
+    void set(Handle handle, Event event)
+    {
+        auto timer = time(handle, &Latency::publish);
+        publish(handle, event);
+    }
+
+    std::tuple<Line::Level, Line::Level> wait_for_edge(Handle handle, Signal signal, Line::Level level)
+    {
+        auto mask = signal == Signal::SDA ? 1U : 2U;
+        return wait(handle, {mask, level == Line::Level::High ? mask : 0U, true, false});
+    }
+
+    std::tuple<Line::Level, Line::Level> wait_for_change(Handle handle, Line::Level sda, Line::Level scl)
+    {
+        return wait(handle, {3U, encode(sda, scl), false, false});
+    }
+
+    void subscribe(Handle handle)
+    {
+        clients_[handle].subscribed = true;
+    }
+
+    void subscribe(Handle handle, uint16_t address)
+    {
+        auto index = slot(address);
+        std::lock_guard<std::mutex> lock(lines_mutex_);
+        auto & entry = addresses_[index];
+        if (entry != NONE && entry != handle) {
+            throw std::invalid_argument("address in use");
+        }
+
+        entry = handle;
+        if (index >= 128 && prefixes_[address >> 8 & 3] == NONE) {
+            prefixes_[address >> 8 & 3] = handle;
+        }
+        clients_[handle].addressed = true;
+        clients_[handle].subscribed = true;
+    }
+
+    Detector::Symbol wait_for_symbol(Handle handle)
+    {
+        wait(handle, {0U, 0U, true, true});
+
+        auto & self = clients_[handle];
+        auto head = self.symbols_head.load(std::memory_order_relaxed);
+        if (head == self.symbols_tail.load()) {
+            // Woken.
+            return Detector::Symbol::None;
+        }
+
+        auto symbol = self.symbols[head % SYMBOLS];
+        self.symbols_head.store(head + 1);
+        return symbol;
+    }
+
+    std::size_t symbols(Handle handle) const
+    {
+        const auto & self = clients_[handle];
+        return self.symbols_tail.load() - self.symbols_head.load(std::memory_order_relaxed);
+    }
+
+    void wake(Handle handle)
+    {
+        std::lock_guard<std::mutex> lock(park_mutex_);
+        auto & client = clients_[handle];
+        client.woken = true;
+
+        if (client.parked.load()) {
+            locked_unpark(client);
+            wait_condition_.notify_all();
+            count(wakeups_);
+        }
     }
 };
 
-Bus::Bus() : pimpl{std::make_unique<Impl>()}
+Bus::Bus(std::size_t capacity) : pimpl{std::make_unique<Impl>(nullptr, capacity)}
+{
+}
+
+Bus::Bus(Scheduler * scheduler, std::size_t capacity) : pimpl{std::make_unique<Impl>(scheduler, capacity)}
 {
 }
 
 Bus::~Bus() = default;
 
-void Bus::attach(const Node * node)
+Bus::Handle Bus::attach(const Node * node)
+{
+    return pimpl->attach(node);
+}
+
+void Bus::detach(Handle handle)
+{
+    pimpl->detach(handle);
+}
+
+void Bus::attach(TransactionInterface * target, uint16_t address)
+{
+    pimpl->attach(target, address);
+}
+
+void Bus::detach(TransactionInterface * target)
+{
+    pimpl->detach(target);
+}
+
+TransactionInterface * Bus::target(uint16_t address)
+{
+    return pimpl->target(address);
+}
+
+void Bus::transaction_level(bool enable)
+{
+    pimpl->transaction_level(enable);
+}
+
+bool Bus::transaction_level() const
+{
+    return pimpl->transaction_level();
+}
+
+void Bus::timing(const Timing & timing)
+{
+    pimpl->timing(timing);
+}
+
+Bus::Timing Bus::timing() const
+{
+    return pimpl->timing();
+}
+
+void Bus::wait_policy(WaitPolicy policy)
+{
+    pimpl->wait_policy(policy);
+}
+
+Bus::WaitPolicy Bus::wait_policy() const
+{
+    return pimpl->wait_policy();
+}
+
+uint64_t Bus::time() const
+{
+    return pimpl->time();
+}
+
+void Bus::latency_histograms(bool enable)
+{
+    pimpl->latency_histograms(enable);
+}
+
+bool Bus::latency_histograms() const
+{
+    return pimpl->latency_histograms();
+}
+
+Bus::Statistics Bus::statistics() const
+{
+    return pimpl->statistics();
+}
+
+void Bus::reset_statistics()
+{
+    pimpl->reset_statistics();
+}
+
+void Bus::attach(MonitorInterface * monitor)
+{
+    pimpl->attach(monitor);
+}
+
+void Bus::detach(MonitorInterface * monitor)
+{
+    pimpl->detach(monitor);
+}
+
+std::tuple<Line::Level, Line::Level> Bus::get(Handle handle)
+{
+    return pimpl->get(handle);
+}
+
+void Bus::set(Handle handle, Event event)
+{
+    pimpl->set(handle, event);
+}
+
+std::tuple<Line::Level, Line::Level> Bus::wait_for_edge(Handle handle, Signal signal, Line::Level level)
+{
+    return pimpl->wait_for_edge(handle, signal, level);
+}
+
+std::tuple<Line::Level, Line::Level> Bus::wait_for_change(Handle handle, Line::Level sda, Line::Level scl)
+{
+    return pimpl->wait_for_change(handle, sda, scl);
+}
+
+bool Bus::busy(Handle handle)
+{
+    return pimpl->busy(handle);
+}
+
+void Bus::wait_for_idle(Handle handle, std::chrono::steady_clock::time_point deadline)
+{
+    pimpl->wait_for_idle(handle, deadline);
+}
+
+void Bus::wake(Handle handle)
+{
+    pimpl->wake(handle);
+}
+
+void Bus::subscribe(Handle handle)
 {
-    pimpl->attach(node);
+    pimpl->subscribe(handle);
 }
 
-void Bus::detach(const Node * node)
+void Bus::subscribe(Handle handle, uint16_t address)
 {
-    pimpl->detach(node);
+    pimpl->subscribe(handle, address);
 }
 
-std::tuple<Line::Level, Line::Level> Bus::get(const Node * node)
+Detector::Symbol Bus::wait_for_symbol(Handle handle)
 {
-    return pimpl->get(node);
+    return pimpl->wait_for_symbol(handle);
 }
 
-void Bus::set(const Node * node, Event event)
+std::size_t Bus::symbols(Handle handle) const
 {
-    pimpl->set(node, event);
+    return pimpl->symbols(handle);
 }
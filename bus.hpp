@@ -1,11 +1,20 @@
 #pragma once
 
+#include "detector.hpp"
+#include "histogram.hpp"
 #include "line.hpp"
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <tuple>
+#include <vector>
 
 class Node;
+class Scheduler;
+class TransactionInterface;
+class MonitorInterface;
 
 /// Bus class.
 /// @discussion Models an I²C bus to which nodes are attached.
@@ -17,22 +26,206 @@ class Bus
     std::unique_ptr<Impl> pimpl;
 
 public:
+    /// Default maximum number of attached nodes.
+    static constexpr std::size_t DEFAULT_CAPACITY = 256;
+
+    /// Identifies an attached node.
+    using Handle = std::size_t;
+
+    /// Flag of a 10-bit target address (as Linux @c I2C_ADDR_OFFSET_TEN_BIT).
+    /// @discussion A 10-bit address is written as @c TEN_BIT|address; an address without the flag is a 7-bit address.
+    static constexpr uint16_t TEN_BIT = 0xA000;
+
+    /// Bus statistics.
+    struct Statistics
+    {
+        /// Events processed.
+        uint64_t events;
+
+        /// Events processed by another node's publisher, in the same batch as its own event.
+        uint64_t coalesced;
+
+        /// Publishers that found another node publishing, and waited.
+        uint64_t pending_waits;
+
+        /// Threads that parked (rather than spinning) to wait.
+        uint64_t parks;
+
+        /// Notifications of parked threads.
+        uint64_t wakeups;
+
+        /// Checks by a publisher that found a node not yet synchronized.
+        uint64_t sync_failures;
+
+        /// Average time (ns) of a publish, for which waiting threads spin (see @c WaitPolicy).
+        uint64_t publish_time;
+
+        /// Latency (ns) of an attached node.
+        struct Latency
+        {
+            const Node * node;
+
+            /// Time to publish an event (set a line, or delay).
+            Histogram publish;
+
+            /// Time to synchronize with the bus (get the lines, or wait).
+            Histogram sync;
+        };
+
+        /// Latency of each attached node, if latency histograms are enabled.
+        std::vector<Latency> latency;
+
+        /// Simulated time (ns).
+        uint64_t time;
+
+        /// Simulated time (ns) during which the bus was busy, from START to STOP.
+        uint64_t busy;
+
+        /// Simulated duration (ns) of each transaction, from START to STOP.
+        Histogram transactions;
+    };
+
+    /// Bus timing (ns).
+    /// @discussion Simulated time advances by @c rise or @c fall when SCL changes, and by one of the other
+    /// periods for each delay, according to the state of the bus (see UM10204, table 10).
+    struct Timing
+    {
+        /// LOW period of SCL (tLOW).
+        uint64_t low;
+
+        /// HIGH period of SCL (tHIGH).
+        uint64_t high;
+
+        /// Hold time for a (repeated) START condition (tHD;STA).
+        uint64_t hd_sta;
+
+        /// Set-up time for a repeated START condition (tSU;STA).
+        uint64_t su_sta;
+
+        /// Set-up time for a STOP condition (tSU;STO).
+        uint64_t su_sto;
+
+        /// Bus free time between a STOP and START condition (tBUF).
+        uint64_t buf;
+
+        /// Rise time of SCL (tr).
+        uint64_t rise;
+
+        /// Fall time of SCL (tf).
+        uint64_t fall;
+    };
+
+    /// Standard-mode (100 kHz) timing.
+    static constexpr Timing STANDARD_MODE{4700, 4000, 4000, 4700, 4000, 4700, 1000, 300};
+
+    /// Fast-mode (400 kHz) timing.
+    static constexpr Timing FAST_MODE{1300, 600, 600, 600, 600, 1300, 300, 300};
+
+    /// Fast-mode Plus (1 MHz) timing.
+    static constexpr Timing FAST_MODE_PLUS{500, 260, 260, 260, 260, 500, 120, 120};
+
+    /// How threads wait for other threads.
+    /// @discussion Cooperative tasks do not spin: they block until woken, or yield to the scheduler.
+    enum class WaitPolicy
+    {
+        /// Spin, without yielding the processor: for nodes pinned to cores of their own.
+        Spin,
+        /// Spin for about as long as a publish takes, then yield the processor.
+        SpinYield,
+        /// Spin for about as long as a publish takes, then park (block in the kernel) until woken.
+        Park
+    };
+
+    /// Constructor
+    /// @discussion Each attached node runs on its own thread.
+    /// @param capacity Maximum number of attached nodes.
+    explicit Bus(std::size_t capacity = DEFAULT_CAPACITY);
+
     /// Constructor
-    Bus();
+    /// @discussion Attached nodes run as cooperative tasks of @c scheduler, which must outlive the bus.
+    /// A node that waits for a condition blocks its task until the publisher that satisfies the condition wakes it;
+    /// other waits yield to the scheduler instead of the operating system.
+    /// @param scheduler The scheduler.
+    /// @param capacity Maximum number of attached nodes.
+    explicit Bus(Scheduler * scheduler, std::size_t capacity = DEFAULT_CAPACITY);
 
     /// Destructor
     ~Bus();
 
     /// Attach a bus node.
-    void attach(const Node * node);
+    /// @discussion Throws @c std::length_error if the capacity of the bus is exceeded.
+    /// @return Handle Handle that identifies the node in subsequent calls.
+    Handle attach(const Node * node);
 
     /// Detach a bus node.
-    void detach(const Node * node);
+    void detach(Handle handle);
+
+    /// Attach a target that supports transaction-level simulation.
+    /// @discussion Throws @c std::invalid_argument if another target is attached at @c address,
+    /// or @c std::out_of_range if the address is invalid.
+    /// @param address The 7-bit address, or @c TEN_BIT and the 10-bit address.
+    void attach(TransactionInterface * target, uint16_t address);
+
+    /// Detach a target that supports transaction-level simulation.
+    void detach(TransactionInterface * target);
+
+    /// Find a target.
+    /// @discussion Targets are looked up in a table indexed by address, in constant time.
+    /// Throws @c std::out_of_range if the address is invalid.
+    /// @param address The 7-bit address, or @c TEN_BIT and the 10-bit address.
+    /// @return TransactionInterface* The target at the address, or nullptr.
+    TransactionInterface * target(uint16_t address);
+
+    /// Enable transaction-level simulation.
+    /// @discussion Controllers exchange octets directly with addressed targets, without simulating the lines,
+    /// unless the addressed target requires edge-level simulation.
+    void transaction_level(bool enable);
+
+    /// @return bool True if transaction-level simulation is enabled.
+    bool transaction_level() const;
+
+    /// Set the bus timing.
+    /// @discussion The default is @c STANDARD_MODE.
+    void timing(const Timing & timing);
+
+    /// @return Timing The bus timing.
+    Timing timing() const;
+
+    /// Set the wait policy.
+    /// @discussion The default is @c WaitPolicy::Park.  The spin time adapts to the average time of a publish.
+    void wait_policy(WaitPolicy policy);
+
+    /// @return WaitPolicy The wait policy.
+    WaitPolicy wait_policy() const;
+
+    /// @return uint64_t Simulated time (ns) since the bus was constructed.
+    /// @discussion Time only advances as the lines are simulated (not in transaction-level simulation).
+    uint64_t time() const;
+
+    /// Enable latency histograms.
+    /// @discussion Nodes time each publish and synchronization (allocating histograms for all nodes when first enabled).
+    void latency_histograms(bool enable);
+
+    /// @return bool True if latency histograms are enabled.
+    bool latency_histograms() const;
+
+    /// @return Statistics Counters (always maintained), and latency histograms.
+    Statistics statistics() const;
+
+    /// Reset counters and latency histograms.
+    void reset_statistics();
+
+    /// Attach a monitor.
+    /// @discussion The monitor observes each event processed by the bus, until it is detached.
+    void attach(MonitorInterface * monitor);
+
+    /// Detach a monitor.
+    void detach(MonitorInterface * monitor);
 
     /// Get current bus state.
     /// @return int SCL status
     /// @return int SDA status
-    std::tuple<Line::Level, Line::Level> get(const Node * node);
+    std::tuple<Line::Level, Line::Level> get(Handle handle);
 
     enum class Event
     {
@@ -44,5 +237,66 @@ public:
     };
 
     /// Set new bus state.
-    void set(const Node * node, Event event);
+    void set(Handle handle, Event event);
+
+    enum class Signal
+    {
+        SDA,
+        SCL
+    };
+
+    /// Wait for a line to have a level.
+    /// @discussion The calling thread parks (after polling briefly) until an event sets the line to @c level,
+    /// or until the node is woken by @c wake().  A parked node does not need to synchronize with other nodes.
+    /// @return Line::Level SDA level
+    /// @return Line::Level SCL level
+    std::tuple<Line::Level, Line::Level> wait_for_edge(Handle handle, Signal signal, Line::Level level);
+
+    /// Wait for either line to change.
+    /// @discussion As @c wait_for_edge(), but waits until the levels differ from @c sda and @c scl.
+    /// @return Line::Level SDA level
+    /// @return Line::Level SCL level
+    std::tuple<Line::Level, Line::Level> wait_for_change(Handle handle, Line::Level sda, Line::Level scl);
+
+    /// @return bool True if the bus is busy: after a START condition, until a STOP condition.
+    /// @discussion Synchronizes the node with the bus, as @c get().
+    bool busy(Handle handle);
+
+    /// Wait for the bus to be free.
+    /// @discussion As @c wait_for_edge(), but waits until the bus is not busy (a STOP condition was detected),
+    /// for example before a controller sends a START condition on a bus shared with other controllers.
+    /// Also returns at @c deadline, since a bus may be left busy by a node that stopped driving it.
+    /// @param handle The node handle.
+    /// @param deadline The time at which to stop waiting.
+    void wait_for_idle(Handle handle, std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+    /// Wake a node.
+    /// @discussion The current (or next) wait of the node returns immediately.
+    void wake(Handle handle);
+
+    /// Subscribe to symbols.
+    /// @discussion The bus decodes START, STOP and data bit symbols once, as it processes events, and delivers
+    /// them to subscribed nodes.  Symbols are buffered for each node (and dropped if the node does not keep up).
+    void subscribe(Handle handle);
+
+    /// Subscribe to the symbols of transactions addressed to a target.
+    /// @discussion The bus decodes the address after each START condition once, and looks it up in a table indexed
+    /// by address (7-bit and 10-bit addresses have separate slots).  Only the addressed node receives the START and
+    /// address symbols (when the address is complete), and then all symbols until the STOP condition; a node addressed
+    /// after a repeated START condition joins the transaction.  Nodes that are not addressed are not woken.
+    /// The first octet of a 10-bit address (11110XX0) is delivered to one node whose address has the same upper two
+    /// bits, to acknowledge it; if another node is addressed by the second octet, it receives all the address symbols
+    /// then.  A 10-bit read (11110XX1, after a repeated START condition) continues with the node already addressed.
+    /// Throws @c std::invalid_argument if another node subscribed to @c address,
+    /// or @c std::out_of_range if the address is invalid.
+    /// @param address The 7-bit address, or @c TEN_BIT and the 10-bit address.
+    void subscribe(Handle handle, uint16_t address);
+
+    /// Wait for a symbol.
+    /// @discussion As @c wait_for_edge(), but waits until a symbol is available to a subscribed node.
+    /// @return Detector::Symbol The next symbol, or Detector::Symbol::None if the node was woken.
+    Detector::Symbol wait_for_symbol(Handle handle);
+
+    /// @return std::size_t The number of symbols buffered for a subscribed node.
+    std::size_t symbols(Handle handle) const;
 };
@@ -0,0 +1,240 @@
+#include "busfarm.hpp"
+
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class BusFarm::Impl
+{
+    /// A bus, and the scheduler that runs its nodes.
+    struct Shard
+    {
+        Scheduler scheduler;
+        Bus bus;
+
+        explicit Shard(std::size_t capacity) : scheduler{}, bus{&scheduler, capacity}
+        {
+        }
+    };
+
+    struct Worker
+    {
+        /// This mutex protects the queue, which the worker takes from the back, and other workers steal from the front.
+        std::mutex mutex;
+
+        /// Queued shards.
+        std::deque<Shard *> queue;
+
+        /// Worker thread.
+        std::thread thread;
+    };
+
+    /// Buses, in the order added.
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    /// Workers.
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    /// This mutex protects the following member variables.
+    std::mutex mutex_;
+
+    /// Number of shards in worker queues.
+    std::size_t queued_;
+
+    /// Number of shards queued or running.
+    std::size_t remaining_;
+
+    /// True when the workers should exit.
+    bool stopping_;
+
+    /// The first exception thrown by a scheduler, such as a deadlock.
+    std::exception_ptr error_;
+
+    /// Signalled when shards are queued, or when stopping.
+    std::condition_variable condition_;
+
+    /// Signalled when all shards have completed.
+    std::condition_variable done_condition_;
+
+    /// Take a shard, from our own queue if possible, otherwise from another worker's queue.
+    /// @return Shard* The shard, or nullptr if all queues are empty.
+    Shard * take(std::size_t index)
+    {
+        Shard * shard{};
+
+        for (std::size_t i = 0; i < workers_.size() && !shard; ++i) {
+            auto & worker = *workers_[(index + i) % workers_.size()];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            if (worker.queue.empty()) {
+                continue;
+            }
+
+            if (i == 0) {
+                shard = worker.queue.back();
+                worker.queue.pop_back();
+            } else {
+                shard = worker.queue.front();
+                worker.queue.pop_front();
+            }
+        }
+
+        if (shard) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queued_--;
+        }
+        return shard;
+    }
+
+    void work(std::size_t index)
+    {
+        for (;;) {
+            auto shard = take(index);
+            if (!shard) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                condition_.wait(lock, [&]{
+                    return queued_ > 0 || stopping_;
+                });
+
+                if (queued_ == 0) {
+                    return;
+                }
+                continue;
+            }
+
+            // Run the bus to completion.  (Tasks must resume on the thread that started them.)
+            std::exception_ptr error;
+            try {
+                shard->scheduler.run();
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (error && !error_) {
+                error_ = error;
+            }
+            if (--remaining_ == 0) {
+                done_condition_.notify_all();
+            }
+        }
+    }
+
+public:
+    Impl(std::size_t workers) : shards_{}, workers_{}, mutex_{}, queued_{}, remaining_{}, stopping_{}, error_{}, condition_{}, done_condition_{}
+    {
+        if (workers == 0) {
+            workers = std::max(1U, std::thread::hardware_concurrency());
+        }
+
+        for (std::size_t i = 0; i < workers; ++i) {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+
+        for (std::size_t i = 0; i < workers; ++i) {
+            workers_[i]->thread = std::thread([this, i]{
+                work(i);
+            });
+        }
+    }
+
+    ~Impl()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_condition_.wait(lock, [&]{
+                return remaining_ == 0;
+            });
+            stopping_ = true;
+        }
+        condition_.notify_all();
+
+        for (auto & worker : workers_) {
+            worker->thread.join();
+        }
+    }
+
+    std::size_t workers() const
+    {
+        return workers_.size();
+    }
+
+    Bus * add_bus(std::size_t capacity)
+    {
+        shards_.push_back(std::make_unique<Shard>(capacity));
+        return &shards_.back()->bus;
+    }
+
+    void spawn(Bus * bus, const std::string & name, std::function<void()> task)
+    {
+        auto it = std::find_if(shards_.begin(), shards_.end(), [bus](const std::unique_ptr<Shard> & shard){
+            return &shard->bus == bus;
+        });
+        if (it == shards_.end()) {
+            throw std::invalid_argument("bus not in farm");
+        }
+
+        (*it)->scheduler.spawn(name, std::move(task));
+    }
+
+    void run()
+    {
+        if (shards_.empty()) {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        // Deal the shards to the workers; idle workers steal from busy ones.
+        for (std::size_t i = 0; i < shards_.size(); ++i) {
+            auto & worker = *workers_[i % workers_.size()];
+            std::lock_guard<std::mutex> queue_lock(worker.mutex);
+            worker.queue.push_back(shards_[i].get());
+        }
+
+        queued_ += shards_.size();
+        remaining_ += shards_.size();
+        condition_.notify_all();
+
+        done_condition_.wait(lock, [&]{
+            return remaining_ == 0;
+        });
+
+        if (error_) {
+            std::rethrow_exception(std::exchange(error_, nullptr));
+        }
+    }
+};
+
+BusFarm::BusFarm(std::size_t workers) : pimpl{std::make_unique<Impl>(workers)}
+{
+}
+
+BusFarm::~BusFarm() = default;
+
+std::size_t BusFarm::workers() const
+{
+    return pimpl->workers();
+}
+
+Bus * BusFarm::add_bus(std::size_t capacity)
+{
+    return pimpl->add_bus(capacity);
+}
+
+void BusFarm::spawn(Bus * bus, const std::string & name, std::function<void()> task)
+{
+    pimpl->spawn(bus, name, std::move(task));
+}
+
+void BusFarm::run()
+{
+    pimpl->run();
+}
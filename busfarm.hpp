@@ -0,0 +1,50 @@
+#pragma once
+
+#include "bus.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+/// Bus farm class.
+/// @discussion Simulates many independent buses on a fixed-size pool of worker threads.
+/// Each bus is constructed with its own @c Scheduler, so its nodes run as cooperative tasks; @c run() then
+/// shares the buses among the workers, which take buses from their own queue and steal from the queues of
+/// other workers when idle.  A bus runs to completion on the worker that takes it, so the number of threads
+/// depends on the size of the pool rather than on the number of buses or nodes.
+/// Tasks must only wait for nodes on their own bus.
+class BusFarm
+{
+    class Impl;
+    std::unique_ptr<Impl> pimpl;
+
+public:
+    /// Constructor.
+    /// @param workers The number of worker threads, or 0 for the number of hardware threads.
+    explicit BusFarm(std::size_t workers = 0);
+
+    /// Destructor.
+    /// @discussion Waits for running buses to complete.
+    ~BusFarm();
+
+    /// @return std::size_t The number of worker threads.
+    std::size_t workers() const;
+
+    /// Add a bus.
+    /// @param capacity The maximum number of nodes attached to the bus.
+    /// @return Bus* The bus, owned by the farm.
+    Bus * add_bus(std::size_t capacity = Bus::DEFAULT_CAPACITY);
+
+    /// Spawn a task on a bus.
+    /// @discussion The task is started by @c run(), on the worker running @c bus.
+    /// @param bus A bus added with @c add_bus().
+    /// @param name The name of the task.
+    /// @param task The task.
+    void spawn(Bus * bus, const std::string & name, std::function<void()> task);
+
+    /// Run all tasks on all buses until they complete.
+    /// @discussion If a scheduler throws, such as when the tasks on a bus deadlock (see @c Scheduler::run()), the
+    /// other buses still run to completion, then the first exception is rethrown.
+    void run();
+};
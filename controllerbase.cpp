@@ -3,21 +3,158 @@
 #include "bus.hpp"
 #include "log.hpp"
 #include "node.hpp"
+#include "transactioninterface.hpp"
+
+#include <atomic>
+#include <cerrno>
 
 class ControllerBase::Impl : public Node
 {
+    /// Bus that the controller is connected to.
+    Bus * bus_;
+
+    /// True while an edge-level transaction is in progress.
     bool started_;
 
+    /// True while a transaction-level transaction is in progress.
+    bool transaction_;
+
+    /// Target addressed by the transaction-level transaction, or nullptr if no target acknowledged.
+    TransactionInterface * target_;
+
+    /// Result of the last octet sent (or ARBITRATION_LOST or TIMEOUT, until the next START condition).
+    Result result_;
+
+    /// Clock stretching timeout.
+    Timeout timeout_;
+
+    /// Set by abort(), from any thread.
+    std::atomic_bool aborted_;
+
+    /// Thrown when a wait for the bus times out, or is aborted, to abandon the operation.
+    struct Abandoned {};
+
+    /// Abandon the transaction: recover the bus, and report the timeout.
+    void abandon()
+    {
+        LOG_DEBUG << "abandoned";
+
+        recover();
+        result_ = Result::TIMEOUT;
+    }
+
+    /// Record the acknowledgement of an octet.
+    /// @return bool True if the octet was not acknowledged.
+    bool acknowledged(bool ack)
+    {
+        result_ = ack ? Result::ACK : Result::NACK;
+        return !ack;
+    }
+
+    /// Begin a transaction-level transaction, if possible.
+    /// @discussion An edge-level transaction continues at edge level until stopped.
+    /// @return bool True if the transaction proceeds at transaction level.
+    /// @param address The 7-bit address, or @c Bus::TEN_BIT and the 10-bit address.
+    bool begin_transaction(uint16_t address)
+    {
+        if (started_ || !bus_->transaction_level()) {
+            return false;
+        }
+
+        auto target = bus_->target(address);
+        if (target && target->edge_level()) {
+            end_transaction();
+            return false;
+        }
+
+        if (target_ && target_ != target) {
+            target_->transaction_stop();
+        }
+
+        LOG_DEBUG << "transaction start";
+
+        transaction_ = true;
+        target_ = target;
+        return true;
+    }
+
+    /// End a transaction-level transaction.
+    void end_transaction()
+    {
+        if (target_) {
+            target_->transaction_stop();
+        }
+
+        if (transaction_) {
+            LOG_DEBUG << "transaction stop";
+        }
+
+        transaction_ = false;
+        target_ = nullptr;
+    }
+
+    /// Wait while another node holds SCL low.
+    /// @discussion Throws Abandoned if the timeout expires, or the controller is aborted.
     void clock_stretching()
     {
+        if (scl() == Line::Level::High) {
+            return;
+        }
+
+        auto time = bus_->time();
+        auto simulated = time + timeout_.simulated;
+        auto wall = std::chrono::steady_clock::now() + timeout_.wall;
+
         while (scl() == Line::Level::Low) {
-            //TODO: timeout
             LOG_DEBUG << "clock stretched";
+
+            if (timeout_.wall.count() && bus_->time() != time) {
+                // Simulated time advances: the bus does not stand still.
+                time = bus_->time();
+                wall = std::chrono::steady_clock::now() + timeout_.wall;
+            }
+
+            if (aborted_.exchange(false)
+                || (timeout_.simulated && bus_->time() >= simulated)
+                || (timeout_.wall.count() && std::chrono::steady_clock::now() >= wall)) {
+                LOG_DEBUG << "clock stretching timeout";
+                throw Abandoned{};
+            }
         }
     }
 
+    /// Wait for the bus to be free.
+    /// @discussion Throws Abandoned if the controller is aborted, or if the bus stands still for the wall-clock
+    /// timeout: a node may leave the bus busy (for example, a target that holds SDA low after this controller lost
+    /// arbitration) without publishing events.
+    void wait_for_bus()
+    {
+        auto time = bus_->time();
+        auto none = std::chrono::steady_clock::time_point::max();
+        auto deadline = timeout_.wall.count() ? std::chrono::steady_clock::now() + timeout_.wall : none;
+
+        // The wait also returns when woken by abort(), at the deadline, or for a stale wake.
+        do {
+            wait_for_idle(deadline);
+            if (aborted_.exchange(false)) {
+                throw Abandoned{};
+            }
+
+            if (deadline != none && std::chrono::steady_clock::now() >= deadline) {
+                if (bus_->time() == time && busy()) {
+                    LOG_DEBUG << "bus wait timeout";
+                    throw Abandoned{};
+                }
+
+                time = bus_->time();
+                deadline = std::chrono::steady_clock::now() + timeout_.wall;
+            }
+        } while (busy());
+    }
+
     /// Write I²C START condition.
     /// @discussion A start condition is signalled by SDA being pulled low while SCL stays high.
+    /// The controller first waits for the bus to be free, since another controller may own it.
     void write_start_condition()
     {
         if (started_) {
@@ -28,8 +165,12 @@ class ControllerBase::Impl : public Node
             scl(Line::Level::High);
             clock_stretching();
             delay();
+        } else {
+            wait_for_bus();
         }
 
+        result_ = Result::ACK;
+
         LOG_DEBUG << "start";
 
         sda(Line::Level::Low);
@@ -61,18 +202,37 @@ class ControllerBase::Impl : public Node
     /// Write a bit.
     /// @discussion Drive SDA, then pulse SCL.
     /// Other bus nodes sample SDA while SCL is high.
-    void write_bit(Line::Level bit)
+    /// If SDA reads back low while driven high, another controller is driving it: arbitration is lost, and the
+    /// controller leaves both lines released for the controller that won (without a STOP condition).
+    /// @return bool False if arbitration was lost.
+    bool write_bit(Line::Level bit)
     {
         LOG_DEBUG << "write bit:" << static_cast<int>(bit);
 
         sda(bit);
         delay();
         scl(Line::Level::High);
-        delay();
         clock_stretching();
+
+        if (bit == Line::Level::High && sda() == Line::Level::Low) {
+            if (!busy()) {
+                // A controller that wins arbitration has sent a START condition: SDA is stuck.
+                LOG_DEBUG << "SDA held low";
+                throw Abandoned{};
+            }
+
+            LOG_DEBUG << "arbitration lost";
+
+            result_ = Result::ARBITRATION_LOST;
+            started_ = false;
+            return false;
+        }
+
+        delay();
         scl(Line::Level::Low);
 
         LOG_DEBUG << "written";
+        return true;
     }
 
     /// Read a bit.
@@ -93,14 +253,81 @@ class ControllerBase::Impl : public Node
         return bit;
     }
 
-public:
-    Impl(const std::string & name, Bus * bus) : Node{name, bus}, started_{}
+    /// Send a START (or repeated START) condition and the first octet.
+    /// @param address The 7-bit address, or @c Bus::TEN_BIT and the 10-bit address.
+    /// @return bool True if the octet was not acknowledged.
+    bool start(uint8_t octet, uint16_t address)
     {
+        if (begin_transaction(address)) {
+            return acknowledged(target_ && target_->transaction_start(octet));
+        }
+
+        write_start_condition();
+        return send(octet);
     }
 
-    uint8_t read(ReadFlag flags)
+    /// Send a START (or repeated START) condition and the first octet.
+    /// @discussion The first octet of a 10-bit address does not identify the target, so the transaction proceeds at edge level.
+    /// @return bool True if the octet was not acknowledged.
+    bool start(uint8_t octet)
     {
-        LOG_DEBUG << "read";
+        if ((octet & 0xF8) == 0xF0) {
+            end_transaction();
+            write_start_condition();
+            return send(octet);
+        }
+
+        return start(octet, static_cast<uint16_t>(octet >> 1));
+    }
+
+    /// Send a STOP condition.
+    /// @discussion Nothing is sent if arbitration was lost.
+    void stop()
+    {
+        if (transaction_) {
+            end_transaction();
+        } else if (result_ != Result::ARBITRATION_LOST) {
+            write_stop_condition();
+        }
+    }
+
+    /// Send an octet and sample the acknowledgement.
+    /// @return bool True if the octet was not acknowledged (or arbitration was lost).
+    bool send(uint8_t octet)
+    {
+        if (transaction_) {
+            return acknowledged(target_ && target_->transaction_write(octet));
+        }
+
+        if (result_ == Result::ARBITRATION_LOST) {
+            return true;
+        }
+
+        for (auto bit = 0; bit < 8; ++bit) {
+            auto level = (octet & 0x80) != 0 ? Line::Level::High : Line::Level::Low;
+            if (!write_bit(level)) {
+                return true;
+            }
+            octet <<= 1;
+        }
+
+        return acknowledged(read_bit() == Line::Level::Low);
+    }
+
+    /// Receive an octet and send the acknowledgement.
+    /// @discussion Arbitration is lost if another controller acknowledges an octet that this controller does not.
+    /// @param nack True to not acknowledge the octet.
+    /// @return uint8_t The octet, or 0xFF if arbitration was lost.
+    uint8_t receive(bool nack)
+    {
+        if (transaction_) {
+            // SDA is pulled up if no target is driving it.
+            return target_ ? target_->transaction_read(nack) : uint8_t{0xFF};
+        }
+
+        if (result_ == Result::ARBITRATION_LOST) {
+            return 0xFF;
+        }
 
         uint8_t octet{};
         for (int bit = 0; bit < 8; ++bit) {
@@ -110,77 +337,204 @@ public:
             }
         }
 
-        // Default to acknowledge.
-        auto nack = Line::Level::Low;
-
-        if (flags & ReadFlag::NACK) {
-            nack = Line::Level::High;
+        LOG_DEBUG << "nack:" << nack;
+        if (!write_bit(nack ? Line::Level::High : Line::Level::Low)) {
+            return 0xFF;
         }
 
-        LOG_DEBUG << "nack:" << static_cast<int>(nack);
-        write_bit(nack);
+        return octet;
+    }
 
-        if (flags & ReadFlag::STOP) {
-            write_stop_condition();
-        }
+public:
+    Impl(const std::string & name, Bus * bus) : Node{name, bus}, bus_{bus}, started_{}, transaction_{}, target_{}, result_{}, timeout_{DEFAULT_TIMEOUT}, aborted_{}
+    {
+    }
 
-        LOG_DEBUG << "read=" << Log::octet(octet);
-        return octet;
+    Result result() const
+    {
+        return result_;
+    }
+
+    void timeout(const Timeout & timeout)
+    {
+        timeout_ = timeout;
+    }
+
+    Timeout timeout() const
+    {
+        return timeout_;
+    }
+
+    void abort()
+    {
+        LOG_DEBUG << "abort";
+
+        aborted_ = true;
+        wake();
+    }
+
+    uint8_t read(ReadFlag flags)
+    {
+        LOG_DEBUG << "read";
+
+        aborted_ = false;
+        try {
+            auto octet = receive(flags & ReadFlag::NACK);
+
+            if (flags & ReadFlag::STOP) {
+                stop();
+            }
+
+            LOG_DEBUG << "read=" << Log::octet(octet);
+            return octet;
+        } catch (const Abandoned &) {
+            abandon();
+            return 0xFF;
+        }
     }
 
     bool write(uint8_t octet, WriteFlag flags)
     {
         LOG_DEBUG << "write octet:" << Log::octet(octet);
 
-        if (flags & WriteFlag::START) {
-            write_start_condition();
+        aborted_ = false;
+        try {
+            auto nack = flags & WriteFlag::START ? start(octet) : send(octet);
+            LOG_DEBUG << "nack=" << nack;
+
+            if (flags & WriteFlag::STOP) {
+                stop();
+            }
+
+            LOG_DEBUG << "written";
+            return nack;
+        } catch (const Abandoned &) {
+            abandon();
+            return true;
         }
+    }
 
-        for (auto bit = 0; bit < 8; ++bit) {
-            auto level = (octet & 0x80) != 0 ? Line::Level::High : Line::Level::Low;
-            write_bit(level);
-            octet <<= 1;
+    void finish()
+    {
+        // Arbitration lost, timeouts and STOP conditions end a transaction.
+        if (!started_ && !transaction_) {
+            return;
         }
 
-        auto nack_bit = read_bit();
-        LOG_DEBUG << "nack=" << static_cast<int>(nack_bit);
+        aborted_ = false;
+        try {
+            stop();
+        } catch (const Abandoned &) {
+            abandon();
+        }
+    }
 
-        if (flags & WriteFlag::STOP) {
-            write_stop_condition();
+    bool transfer(const Message * messages, std::size_t count)
+    {
+        LOG_DEBUG << "transfer:" << count;
+
+        aborted_ = false;
+        try {
+            return transfer_messages(messages, count);
+        } catch (const Abandoned &) {
+            abandon();
+            return true;
         }
+    }
 
-        LOG_DEBUG << "written";
-        return nack_bit == Line::Level::High;
+    /// Transfer messages.
+    /// @discussion Throws Abandoned if the transfer times out.
+    bool transfer_messages(const Message * messages, std::size_t count)
+    {
+        auto nack = false;
+
+        for (std::size_t i = 0; i < count && !nack; ++i) {
+            const auto & message = messages[i];
+            auto read_operation = message.flags & MessageFlag::READ;
+
+            if (message.flags & MessageFlag::TEN) {
+                auto address = static_cast<uint16_t>(Bus::TEN_BIT | (message.address & 0x3FF));
+                auto prefix = static_cast<uint8_t>(0xF0 | (message.address >> 7 & 0x06));
+
+                nack = start(prefix, address);
+                if (!nack && !transaction_) {
+                    nack = send(static_cast<uint8_t>(message.address));
+                }
+                if (!nack && read_operation) {
+                    nack = start(static_cast<uint8_t>(prefix | 1), address);
+                }
+            } else {
+                nack = start(static_cast<uint8_t>(message.address << 1 | (read_operation ? 1 : 0)), message.address);
+            }
+
+            for (std::size_t n = 0; n < message.length && !nack; ++n) {
+                if (read_operation) {
+                    message.buffer[n] = receive(n + 1 == message.length);
+                    nack = result_ == Result::ARBITRATION_LOST;
+                } else {
+                    nack = send(message.buffer[n]);
+                }
+            }
+        }
+
+        stop();
+
+        LOG_DEBUG << "transferred nack=" << nack;
+        return nack;
     }
 
     int recover()
     {
         LOG_DEBUG << "recover";
 
-        scl(Line::Level::Low);
-        delay();
+        if (transaction_) {
+            // The lines were not driven.
+            end_transaction();
+
+            LOG_DEBUG << "recovered";
+            return 0;
+        }
 
-        int counter{};
-        for (;;) {
-            // Pulse SCL until we get 'NUM_SAMPLES' of SDA HIGH samples.
-            constexpr auto NUM_SAMPLES = 9;
-            auto level = read_bit();
+        // Pulse SCL until we get 'NUM_SAMPLES' of SDA HIGH samples, within an octet, its acknowledgement and
+        // 'NUM_SAMPLES' more pulses.
+        constexpr auto NUM_SAMPLES = 9;
+        constexpr auto MAX_PULSES = 2 * NUM_SAMPLES;
 
-            if (level == Line::Level::High) {
-                if (++counter == NUM_SAMPLES) {
-                    write_stop_condition();
-                    break;
+        auto result = -EBUSY;
+        try {
+            scl(Line::Level::Low);
+            delay();
+
+            int counter{};
+            for (auto pulse = 0; pulse < MAX_PULSES; ++pulse) {
+                auto level = read_bit();
+
+                if (level == Line::Level::High) {
+                    if (++counter == NUM_SAMPLES) {
+                        write_stop_condition();
+                        result = 0;
+                        break;
+                    }
+                } else {
+                    // Non-HIGH sample.
+                    counter = 0;
                 }
-            } else {
-                // Non-HIGH sample.
-                counter = 0;
+
+                LOG_DEBUG << "recover=" << counter;
             }
+        } catch (const Abandoned &) {
+            result = -ETIMEDOUT;
+        }
 
-            LOG_DEBUG << "recover=" << counter;
+        if (result) {
+            // Release the lines, for the node that holds them.
+            sda(Line::Level::High);
+            scl(Line::Level::High);
+            started_ = false;
         }
 
-        LOG_DEBUG << "recovered";
-        return 0;
+        LOG_DEBUG << "recovered=" << result;
+        return result;
     }
 };
 
@@ -200,6 +554,59 @@ bool ControllerBase::write(uint8_t octet, WriteFlag flags)
     return pimpl->write(octet, flags);
 }
 
+bool ControllerBase::transfer(const Message * messages, std::size_t count)
+{
+    return pimpl->transfer(messages, count);
+}
+
+bool ControllerBase::write(uint8_t address, const uint8_t * data, std::size_t length)
+{
+    // Write messages do not modify the buffer.
+    Message message{address, MessageFlag::NONE, length, const_cast<uint8_t *>(data)};
+    return pimpl->transfer(&message, 1);
+}
+
+bool ControllerBase::read(uint8_t address, uint8_t * buffer, std::size_t length)
+{
+    Message message{address, MessageFlag::READ, length, buffer};
+    return pimpl->transfer(&message, 1);
+}
+
+bool ControllerBase::write_then_read(uint8_t address, const uint8_t * data, std::size_t length, uint8_t * buffer, std::size_t size)
+{
+    // Write messages do not modify the buffer.
+    Message messages[] = {
+        {address, MessageFlag::NONE, length, const_cast<uint8_t *>(data)},
+        {address, MessageFlag::READ, size, buffer}
+    };
+    return pimpl->transfer(messages, 2);
+}
+
+ControllerBase::Result ControllerBase::result() const
+{
+    return pimpl->result();
+}
+
+void ControllerBase::timeout(const Timeout & timeout)
+{
+    pimpl->timeout(timeout);
+}
+
+ControllerBase::Timeout ControllerBase::timeout() const
+{
+    return pimpl->timeout();
+}
+
+void ControllerBase::abort()
+{
+    pimpl->abort();
+}
+
+void ControllerBase::stop()
+{
+    pimpl->finish();
+}
+
 int ControllerBase::recover()
 {
     return pimpl->recover();
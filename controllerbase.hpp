@@ -3,6 +3,8 @@
 #include "bitmask_operators.hpp"
 #include "line.hpp"
 
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -12,6 +14,13 @@ class Bus;
 /// ControllerBase class.
 /// @discussion Models an I²C controller connected to a I²C bus.
 /// Methods are provided to read and write octets with flags to allow control of start/stop conditions and acknowledgements.
+/// If transaction-level simulation is enabled on the bus, octets are exchanged directly with the addressed target
+/// (see @c TransactionInterface) unless that target requires edge-level simulation.
+/// Several controllers may share a bus at edge level: a controller waits for the bus to be free before a START
+/// condition, and arbitration is lost by a controller that reads SDA low while driving it high.
+/// A controller gives up waiting for SCL held low by another node, or for a bus that stands still while busy, after
+/// a timeout (see @c Timeout), and may be aborted from another thread (see @c Watchdog); it then abandons the
+/// transaction and recovers the bus.
 class ControllerBase
 {
     class Impl;
@@ -50,15 +59,132 @@ public:
     /// Write octet.
     /// @param octet The octet to send.
     /// @param flags Flags that control behaviour.
-    /// @return bool True if the octet was not acknowledged by the target.
+    /// @return bool True if the octet was not acknowledged by the target, arbitration was lost, or the transfer timed out (see @c result()).
     bool write(uint8_t octet, WriteFlag flags = WriteFlag::NONE);
 
+    enum class Result
+    {
+        /// The octet was acknowledged.
+        ACK,
+        /// The octet was not acknowledged.
+        NACK,
+        /// Another controller won arbitration: the transaction was abandoned, without a STOP condition.
+        ARBITRATION_LOST,
+        /// SCL was held low for longer than the timeout, SDA was held low without a START condition, or the
+        /// controller was aborted: the transaction was abandoned, and the bus recovered (see @c recover()).
+        TIMEOUT
+    };
+
+    /// @return Result The result of the last octet sent (or ARBITRATION_LOST or TIMEOUT, until the next START condition).
+    /// @discussion Methods that return true if an octet was not acknowledged also return true if arbitration was lost,
+    /// or the transaction timed out (methods that return an octet then return 0xFF).
+    Result result() const;
+
+    /// Clock stretching and bus timeout.
+    /// @discussion A timeout of zero does not expire.
+    struct Timeout
+    {
+        /// Simulated time (ns) for which SCL may be held low.
+        uint64_t simulated;
+
+        /// Wall-clock time for which the bus may stand still while SCL is held low, or while the controller waits
+        /// for the bus to be free.
+        /// @discussion Simulated time does not advance while no node publishes events.
+        std::chrono::nanoseconds wall;
+    };
+
+    /// Default timeout: the SMBus tTIMEOUT (35 ms), of simulated time and of wall-clock time.
+    static constexpr Timeout DEFAULT_TIMEOUT{35000000, std::chrono::milliseconds(35)};
+
+    /// Set the clock stretching timeout.
+    void timeout(const Timeout & timeout);
+
+    /// @return Timeout The clock stretching timeout.
+    Timeout timeout() const;
+
+    /// Abort the current operation.
+    /// @discussion May be called from any thread.  The operation fails with Result::TIMEOUT as soon as the
+    /// controller waits for the bus, and the controller recovers the bus.  An abort while no operation is in
+    /// progress is discarded by the next operation.
+    void abort();
+
+    enum class MessageFlag : unsigned
+    {
+        NONE,
+        /// Read from the target (otherwise write to the target).
+        READ  = 1 << 0,
+        /// The target address is a 10-bit address.
+        TEN   = 1 << 1
+    };
+
+    /// Message.
+    /// @discussion Modelled on the Linux @c struct @c i2c_msg.
+    struct Message
+    {
+        /// 7-bit target address, or 10-bit target address if @c MessageFlag::TEN is set.
+        uint16_t address;
+
+        /// Flags that control behaviour.
+        MessageFlag flags;
+
+        /// Number of octets to read or write.
+        std::size_t length;
+
+        /// Octets to write, or buffer for octets read.
+        /// @discussion Octets of a write message are not modified.
+        uint8_t * buffer;
+    };
+
+    /// Transfer messages.
+    /// @discussion Each message begins with a START (or repeated START) condition and the address octet.
+    /// A 10-bit address is sent as the first octet 11110XX0 and the second octet; a 10-bit read then sends a
+    /// repeated START condition and the first octet 11110XX1.
+    /// The final octet of each read message is not acknowledged.
+    /// A STOP condition is sent after the last message, or as soon as an octet is not acknowledged.
+    /// @param messages The messages.
+    /// @param count The number of messages.
+    /// @return bool True if an octet was not acknowledged by the target, arbitration was lost, or the transfer timed out (see @c result()).
+    bool transfer(const Message * messages, std::size_t count);
+
+    /// Write octets to a target.
+    /// @param address The 7-bit target address.
+    /// @param data The octets to send.
+    /// @param length The number of octets to send.
+    /// @return bool True if an octet was not acknowledged by the target, arbitration was lost, or the transfer timed out (see @c result()).
+    bool write(uint8_t address, const uint8_t * data, std::size_t length);
+
+    /// Read octets from a target.
+    /// @param address The 7-bit target address.
+    /// @param buffer The buffer for octets read.
+    /// @param length The number of octets to read.
+    /// @return bool True if the address was not acknowledged by the target, arbitration was lost, or the transfer timed out (see @c result()).
+    bool read(uint8_t address, uint8_t * buffer, std::size_t length);
+
+    /// Write octets, then read octets after a repeated START condition.
+    /// @discussion Typically used to read registers.
+    /// @param address The 7-bit target address.
+    /// @param data The octets to send.
+    /// @param length The number of octets to send.
+    /// @param buffer The buffer for octets read.
+    /// @param size The number of octets to read.
+    /// @return bool True if an octet was not acknowledged by the target, arbitration was lost, or the transfer timed out (see @c result()).
+    bool write_then_read(uint8_t address, const uint8_t * data, std::size_t length, uint8_t * buffer, std::size_t size);
+
+    /// Send a STOP condition.
+    /// @discussion Ends a transaction begun by octet writes (for example, after an octet was not acknowledged).
+    /// Nothing is sent if no transaction is in progress (or arbitration was lost, or the transaction timed out).
+    void stop();
+
     /// Recover bus.
     /// @discussion SDA may be stuck low due to an interrupted transaction.
-    /// Pulse SCL in order to complete transaction and release SDA.
+    /// Pulse SCL in order to complete transaction and release SDA, then send a STOP condition.
+    /// A target releases SDA within an octet and its acknowledgement, so SCL is pulsed a bounded number of times.
+    /// @return int 0 if the bus was recovered, -EBUSY if SDA is still held low, or -ETIMEDOUT if SCL is held low.
     int recover();
 };
 
 BITMASK_OPERATORS(ControllerBase::WriteFlag)
 
 BITMASK_OPERATORS(ControllerBase::ReadFlag)
+
+BITMASK_OPERATORS(ControllerBase::MessageFlag)
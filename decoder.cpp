@@ -0,0 +1,136 @@
+#include "decoder.hpp"
+
+#include "detector.hpp"
+
+class Decoder::Impl
+{
+    enum class State
+    {
+        /// Waiting for START.
+        Idle,
+        /// Receiving the first octet.
+        Address,
+        /// Receiving a data octet.
+        Data,
+        /// Receiving an ACK bit.
+        Ack
+    };
+
+    /// Called for each record.
+    Callback callback_;
+
+    /// Decodes START, STOP and data bit symbols.
+    Detector detector_;
+
+    State state_;
+
+    /// Octet received so far, and the number of bits.
+    uint8_t octet_;
+    int bits_;
+
+    /// Previous SCL level.
+    Line::Level scl_;
+
+    /// The node that most recently pulled SDA low (while SDA remains low).
+    const Node * sda_driver_;
+
+    /// The node that pulled SDA low when SCL rose, for the current bit.
+    const Node * bit_driver_;
+
+    /// The first node that pulled SDA low during the current octet or ACK bit.
+    const Node * field_driver_;
+
+    void emit(Kind kind, uint8_t octet, const Node * node, uint64_t sequence)
+    {
+        const Record record{kind, octet, node, sequence};
+        callback_(record);
+    }
+
+    void begin(State state)
+    {
+        state_ = state;
+        octet_ = 0;
+        bits_ = 0;
+        field_driver_ = nullptr;
+    }
+
+    void bit(bool one, uint64_t sequence)
+    {
+        if (!field_driver_) {
+            field_driver_ = bit_driver_;
+        }
+
+        switch (state_) {
+            case State::Idle:
+                break;
+
+            case State::Ack:
+                emit(one ? Kind::Nack : Kind::Ack, 0, field_driver_, sequence);
+                begin(State::Data);
+                break;
+
+            case State::Address:
+            case State::Data:
+                octet_ = static_cast<uint8_t>(octet_ << 1 | (one ? 1 : 0));
+                if (++bits_ == 8) {
+                    emit(state_ == State::Address ? Kind::Address : Kind::Data, octet_, field_driver_, sequence);
+                    begin(State::Ack);
+                }
+                break;
+        }
+    }
+
+public:
+    Impl(Callback callback) : callback_{std::move(callback)}, detector_{}, state_{State::Idle}, octet_{}, bits_{}, scl_{Line::Level::High}, sda_driver_{}, bit_driver_{}, field_driver_{}
+    {
+    }
+
+    void event(uint64_t sequence, const Node * node, Bus::Event event, Line::Level sda, Line::Level scl)
+    {
+        if (event == Bus::Event::DataLow) {
+            sda_driver_ = node;
+        } else if (sda == Line::Level::High) {
+            sda_driver_ = nullptr;
+        }
+
+        if (scl_ == Line::Level::Low && scl == Line::Level::High) {
+            // SCL ▁/▔
+            bit_driver_ = sda == Line::Level::Low ? sda_driver_ : nullptr;
+        }
+        scl_ = scl;
+
+        switch (detector_.update(sda, scl)) {
+            case Detector::Symbol::None:
+                break;
+            case Detector::Symbol::Start:
+                emit(Kind::Start, 0, node, sequence);
+                begin(State::Address);
+                break;
+            case Detector::Symbol::RepeatedStart:
+                emit(Kind::RepeatedStart, 0, node, sequence);
+                begin(State::Address);
+                break;
+            case Detector::Symbol::Stop:
+                emit(Kind::Stop, 0, node, sequence);
+                begin(State::Idle);
+                break;
+            case Detector::Symbol::Bit0:
+                bit(false, sequence);
+                break;
+            case Detector::Symbol::Bit1:
+                bit(true, sequence);
+                break;
+        }
+    }
+};
+
+Decoder::Decoder(Callback callback) : pimpl{std::make_unique<Impl>(std::move(callback))}
+{
+}
+
+Decoder::~Decoder() = default;
+
+void Decoder::event(uint64_t sequence, uint64_t, Bus::Handle, const Node * node, Bus::Event event, Line::Level sda, Line::Level scl)
+{
+    pimpl->event(sequence, node, event, sda, scl);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "monitorinterface.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+class Node;
+
+/// Decoder class.
+/// @discussion Decodes the events processed by a bus (to which it is attached as a monitor) into I²C protocol records:
+/// START, address and R/W', data, ACK/NACK, repeated START and STOP.
+/// Records are passed by reference to a callback, as they are decoded, without being stored.
+/// The decoder may also be fed with events from a capture by calling @c event() directly.
+class Decoder : public MonitorInterface
+{
+    class Impl;
+    std::unique_ptr<Impl> pimpl;
+
+public:
+    enum class Kind : uint8_t
+    {
+        /// START condition.
+        Start,
+        /// Repeated START condition.
+        RepeatedStart,
+        /// First octet after a START condition: 7-bit address and R/W' bit.
+        Address,
+        /// Data octet.
+        Data,
+        /// Acknowledge bit (SDA low).
+        Ack,
+        /// Not acknowledge bit (SDA high).
+        Nack,
+        /// STOP condition.
+        Stop
+    };
+
+    /// Protocol record.
+    struct Record
+    {
+        Kind kind;
+
+        /// Octet, for Kind::Address and Kind::Data.
+        uint8_t octet;
+
+        /// Node that drove the record.
+        /// @discussion For START and STOP conditions, the node that changed SDA.
+        /// For octets and ACK bits, the node that pulled SDA low (or nullptr if SDA was high throughout).
+        const Node * node;
+
+        /// Bus sequence number of the event that completed the record.
+        uint64_t sequence;
+    };
+
+    /// Called for each record.
+    using Callback = std::function<void(const Record & record)>;
+
+    /// Constructor.
+    /// @param callback Called for each record, in order.
+    explicit Decoder(Callback callback);
+
+    /// Destructor.
+    ~Decoder() override;
+
+    /// Decode an event.
+    void event(uint64_t sequence, uint64_t time, Bus::Handle handle, const Node * node, Bus::Event event, Line::Level sda, Line::Level scl) override;
+};
@@ -0,0 +1,78 @@
+#include "detector.hpp"
+
+class Detector::Impl
+{
+    /// Previous SDA level.
+    Line::Level sda_;
+
+    /// Previous SCL level.
+    Line::Level scl_;
+
+    /// True between START and STOP conditions.
+    bool busy_;
+
+    /// True while SCL is high and SDA has not changed since SCL rose.
+    bool sampled_;
+
+public:
+    Impl() : sda_{Line::Level::High}, scl_{Line::Level::High}, busy_{}, sampled_{}
+    {
+    }
+
+    Detector::Symbol update(Line::Level sda, Line::Level scl)
+    {
+        auto symbol = Detector::Symbol::None;
+
+        if (scl != scl_) {
+            if (scl == Line::Level::High) {
+                // SCL ▁/▔
+                sampled_ = true;
+            } else {
+                // SCL ▔\▁
+                if (sampled_) {
+                    symbol = sda_ == Line::Level::High ? Detector::Symbol::Bit1 : Detector::Symbol::Bit0;
+                }
+                sampled_ = false;
+            }
+        } else if (sda != sda_ && scl == Line::Level::High) {
+            sampled_ = false;
+
+            if (sda == Line::Level::Low) {
+                // SCL ▔▔▔▔
+                // SDA ▔▔\▁
+                symbol = busy_ ? Detector::Symbol::RepeatedStart : Detector::Symbol::Start;
+                busy_ = true;
+            } else {
+                // SCL ▔▔▔▔
+                // SDA ▁▁/▔
+                symbol = Detector::Symbol::Stop;
+                busy_ = false;
+            }
+        }
+
+        sda_ = sda;
+        scl_ = scl;
+        return symbol;
+    }
+
+    bool busy() const
+    {
+        return busy_;
+    }
+};
+
+Detector::Detector() : pimpl{std::make_unique<Impl>()}
+{
+}
+
+Detector::~Detector() = default;
+
+Detector::Symbol Detector::update(Line::Level sda, Line::Level scl)
+{
+    return pimpl->update(sda, scl);
+}
+
+bool Detector::busy() const
+{
+    return pimpl->busy();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "line.hpp"
+
+#include <cstdint>
+#include <memory>
+
+/// Detector class.
+/// @discussion Decodes changes of the levels of SDA and SCL into START, STOP and data bit symbols.
+/// A data bit is sampled when SCL rises, and completed when SCL falls (unless SDA changed while SCL was high,
+/// which signals a START or STOP condition instead).
+class Detector
+{
+    class Impl;
+    std::unique_ptr<Impl> pimpl;
+
+public:
+    enum class Symbol : uint8_t
+    {
+        /// No symbol.
+        None,
+        /// START condition.
+        Start,
+        /// START condition while the bus is busy.
+        RepeatedStart,
+        /// STOP condition.
+        Stop,
+        /// Data bit 0.
+        Bit0,
+        /// Data bit 1.
+        Bit1
+    };
+
+    /// Constructor.
+    /// @discussion Both lines are initially high, and the bus is idle.
+    Detector();
+
+    /// Destructor.
+    ~Detector();
+
+    /// Update line levels.
+    /// @return Symbol The symbol completed by the change, or Symbol::None.
+    Symbol update(Line::Level sda, Line::Level scl);
+
+    /// @return bool True after a START condition, until a STOP condition.
+    bool busy() const;
+};
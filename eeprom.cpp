@@ -0,0 +1,114 @@
+#include "eeprom.hpp"
+
+#include "log.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+class Eeprom::Impl
+{
+    /// Back-pointer to parent, which holds the array.
+    Eeprom * parent_;
+
+    std::size_t page_size_;
+
+    /// Page buffer, and flags marking the octets written to it.
+    std::vector<uint8_t> page_;
+    std::vector<uint8_t> written_;
+
+    /// Address of the buffered page, and offset of the next octet within it.
+    std::size_t base_;
+    std::size_t offset_;
+
+    /// True if the page buffer holds data.
+    bool dirty_;
+
+    void clear()
+    {
+        if (dirty_) {
+            std::fill(written_.begin(), written_.end(), 0);
+            dirty_ = false;
+        }
+    }
+
+public:
+    Impl(Eeprom * parent, std::size_t page) : parent_{parent}, page_size_{page}, page_(page), written_(page), base_{}, offset_{}, dirty_{}
+    {
+        if (page_size_ == 0 || (page_size_ & (page_size_ - 1)) || parent_->size() % page_size_) {
+            throw std::invalid_argument("invalid EEPROM page size");
+        }
+    }
+
+    void start()
+    {
+        clear();
+    }
+
+    /// The word address was received.
+    void address(std::size_t address)
+    {
+        base_ = address & ~(page_size_ - 1);
+        offset_ = address & (page_size_ - 1);
+    }
+
+    void write(uint8_t octet)
+    {
+        page_[offset_] = octet;
+        written_[offset_] = 1;
+        dirty_ = true;
+
+        // The address rolls over within the page.
+        offset_ = (offset_ + 1) & (page_size_ - 1);
+    }
+
+    void stop()
+    {
+        if (!dirty_) {
+            return;
+        }
+
+        LOG_DEBUG << "write page " << base_;
+
+        auto array = parent_->registers() + base_;
+        for (std::size_t i = 0; i < page_size_; ++i) {
+            if (written_[i]) {
+                array[i] = page_[i];
+            }
+        }
+        clear();
+
+        parent_->index(base_ + offset_);
+    }
+};
+
+Eeprom::Eeprom(const std::string & name, uint16_t address, Bus * bus, const Model & model, const std::string & path) : RegisterTarget{name, address, bus, model.size, model.address_octets, path}, pimpl{std::make_unique<Impl>(this, model.page)}
+{
+}
+
+Eeprom::~Eeprom() = default;
+
+bool Eeprom::transaction_start(uint8_t octet)
+{
+    pimpl->start();
+    return RegisterTarget::transaction_start(octet);
+}
+
+bool Eeprom::transaction_write(uint8_t octet)
+{
+    if (indexing()) {
+        RegisterTarget::transaction_write(octet);
+        if (!indexing()) {
+            pimpl->address(index());
+        }
+    } else {
+        pimpl->write(octet);
+    }
+    return true;
+}
+
+void Eeprom::transaction_stop()
+{
+    pimpl->stop();
+    RegisterTarget::transaction_stop();
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "registertarget.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class Bus;
+
+/// EEPROM class.
+/// @discussion Models a 24Cxx-family serial EEPROM, whose contents are a memory-mapped file.
+/// A controller write sends the word address (one or two octets, MSB first) followed by up to a page of data.
+/// Data is buffered, wrapping within the page, and written to the array at the STOP condition (an aborted write,
+/// without STOP, is discarded).  A controller read returns octets from the current address, which increments
+/// across the whole array (and wraps to zero), so sequential reads stream straight out of the mapping.
+/// Write cycle time is not modelled: the EEPROM acknowledges immediately after a write.
+class Eeprom : public RegisterTarget
+{
+    class Impl;
+    std::unique_ptr<Impl> pimpl;
+
+public:
+    /// EEPROM organisation.
+    struct Model
+    {
+        /// Number of octets.
+        std::size_t size;
+
+        /// Number of octets of the word address.
+        std::size_t address_octets;
+
+        /// Number of octets per page (a power of two).
+        std::size_t page;
+    };
+
+    /// 2 Kbit (256 × 8), 1-octet word address, 8-octet pages.
+    static constexpr Model M24C02{256, 1, 8};
+
+    /// 32 Kbit (4096 × 8), 2-octet word address, 32-octet pages.
+    static constexpr Model M24C32{4096, 2, 32};
+
+    /// 256 Kbit (32768 × 8), 2-octet word address, 64-octet pages.
+    static constexpr Model M24C256{32768, 2, 64};
+
+    /// 512 Kbit (65536 × 8), 2-octet word address, 128-octet pages.
+    static constexpr Model M24C512{65536, 2, 128};
+
+    /// Constructor.
+    /// @discussion Throws @c std::system_error if the file cannot be mapped.
+    /// @param name The name of the target.
+    /// @param address The 7-bit bus address of the target, or @c Bus::TEN_BIT and the 10-bit address.
+    /// @param bus The bus to connect to.
+    /// @param model The organisation of the EEPROM.
+    /// @param path The image file (created, or extended with zeros, to the size of the EEPROM if necessary).
+    Eeprom(const std::string & name, uint16_t address, Bus * bus, const Model & model, const std::string & path);
+
+    /// Destructor.
+    ~Eeprom() override;
+
+    /// Start condition.
+    /// @discussion Discards data buffered by a write that was not stopped.
+    /// @return bool True (acknowledged).
+    bool transaction_start(uint8_t octet) override;
+
+    /// Controller write.
+    /// @discussion Receives the word address, then buffers data within the page.
+    /// @return bool True (acknowledged).
+    bool transaction_write(uint8_t octet) override;
+
+    /// Stop condition.
+    /// @discussion Writes buffered data to the array.
+    void transaction_stop() override;
+};
@@ -0,0 +1,84 @@
+#include "histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+std::size_t Histogram::bucket(uint64_t value)
+{
+    if (value < SUB_BUCKETS) {
+        return static_cast<std::size_t>(value);
+    }
+
+    // Position of the most significant bit.
+    unsigned exponent = 63;
+    while (!(value >> exponent)) {
+        exponent--;
+    }
+
+    if (exponent > MAX_EXPONENT) {
+        return BUCKETS - 1;
+    }
+
+    // The bits below the most significant bit select the sub-bucket.
+    auto sub_bucket = (value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + static_cast<std::size_t>(sub_bucket);
+}
+
+uint64_t Histogram::lowest(std::size_t bucket)
+{
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+
+    auto exponent = static_cast<unsigned>(bucket / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+    auto sub_bucket = bucket % SUB_BUCKETS;
+    return (SUB_BUCKETS + sub_bucket) << (exponent - SUB_BUCKET_BITS);
+}
+
+Histogram::Histogram() : counts_{}, count_{}
+{
+}
+
+void Histogram::record(uint64_t value, uint64_t count)
+{
+    counts_[bucket(value)] += count;
+    count_ += count;
+}
+
+void Histogram::add(const Histogram & other)
+{
+    for (std::size_t i = 0; i < BUCKETS; ++i) {
+        counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+}
+
+uint64_t Histogram::count() const
+{
+    return count_;
+}
+
+uint64_t Histogram::count(std::size_t bucket) const
+{
+    return counts_[bucket];
+}
+
+uint64_t Histogram::percentile(double percentile) const
+{
+    if (count_ == 0) {
+        return 0;
+    }
+
+    // Rank of the value, from 1 to count_.
+    auto rank = static_cast<uint64_t>(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * static_cast<double>(count_)));
+    rank = std::max<uint64_t>(rank, 1);
+
+    uint64_t total = 0;
+    for (std::size_t i = 0; i < BUCKETS; ++i) {
+        total += counts_[i];
+        if (total >= rank) {
+            return lowest(i);
+        }
+    }
+    return lowest(BUCKETS - 1);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/// Histogram class.
+/// @discussion Counts values (such as latencies in ns) in log-linear buckets: each power of two is divided into
+/// @c SUB_BUCKETS buckets, so that the value reported for a percentile is within 1/SUB_BUCKETS of the true value,
+/// however large.  Values up to @c SUB_BUCKETS are exact; values of 2⁴⁸ and above share the last bucket.
+class Histogram
+{
+public:
+    /// log₂ of the number of buckets per power of two.
+    static constexpr unsigned SUB_BUCKET_BITS = 3;
+
+    /// Number of buckets per power of two.
+    static constexpr std::size_t SUB_BUCKETS = 1U << SUB_BUCKET_BITS;
+
+    /// Largest power of two with its own buckets.
+    static constexpr unsigned MAX_EXPONENT = 47;
+
+    /// Number of buckets.
+    static constexpr std::size_t BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    /// @return std::size_t The bucket that counts @c value.
+    static std::size_t bucket(uint64_t value);
+
+    /// @return uint64_t The smallest value counted by @c bucket.
+    static uint64_t lowest(std::size_t bucket);
+
+    /// Constructor.
+    /// @discussion The histogram is empty.
+    Histogram();
+
+    /// Count a value.
+    /// @param value The value.
+    /// @param count The number of times to count it.
+    void record(uint64_t value, uint64_t count = 1);
+
+    /// Count the values counted by another histogram.
+    void add(const Histogram & other);
+
+    /// @return uint64_t The number of values counted.
+    uint64_t count() const;
+
+    /// @return uint64_t The number of values counted by @c bucket.
+    uint64_t count(std::size_t bucket) const;
+
+    /// @param percentile The percentile (0 to 100).
+    /// @return uint64_t The smallest value of the bucket containing the percentile, or 0 if the histogram is empty.
+    uint64_t percentile(double percentile) const;
+
+private:
+    /// Count per bucket.
+    std::array<uint64_t, BUCKETS> counts_;
+
+    /// Total count.
+    uint64_t count_;
+};
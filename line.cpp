@@ -1,31 +1,56 @@
 #include "line.hpp"
 
-#include <set>
+#include <cstdint>
+#include <vector>
 
 class Line::Impl
 {
-    /// Set of connections which are driving the line low.
-    std::set<const void *> low_;
+    /// Number of slots per word of the bitset.
+    static constexpr std::size_t BITS = 64;
+
+    /// Bitset of slots which are driving the line low.
+    std::vector<uint64_t> low_;
+
+    /// Number of slots which are driving the line low.
+    std::size_t count_;
 
 public:
-    Impl() : low_{}
+    Impl() : low_{}, count_{}
+    {
+    }
+
+    void reserve(std::size_t slots)
     {
+        auto words = (slots + BITS - 1) / BITS;
+        if (words > low_.size()) {
+            low_.resize(words);
+        }
     }
 
     Line::Level get() const
     {
         // If *any* node drives the line low it will be low.
-        return !low_.empty() ? Line::Level::Low : Line::Level::High;
+        return count_ != 0 ? Line::Level::Low : Line::Level::High;
     }
 
-    void set(const void * connection, Line::Level level)
+    void set(std::size_t slot, Line::Level level)
     {
+        auto & word = low_[slot / BITS];
+        auto mask = uint64_t{1} << (slot % BITS);
+        auto low = (word & mask) != 0;
+
         switch (level) {
             case Line::Level::Low:
-                low_.insert(connection);
+                if (!low) {
+                    word |= mask;
+                    count_++;
+                }
                 break;
             case Line::Level::High:
-                low_.erase(connection);
+                if (low) {
+                    word &= ~mask;
+                    count_--;
+                }
                 break;
         }
     }
@@ -37,12 +62,17 @@ Line::Line() : pimpl{std::make_unique<Impl>()}
 
 Line::~Line() = default;
 
+void Line::reserve(std::size_t slots)
+{
+    pimpl->reserve(slots);
+}
+
 Line::Level Line::get() const
 {
     return pimpl->get();
 }
 
-void Line::set(const void * connection, Line::Level level)
+void Line::set(std::size_t slot, Line::Level level)
 {
-    pimpl->set(connection, level);
+    pimpl->set(slot, level);
 }
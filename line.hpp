@@ -1,11 +1,13 @@
 #pragma once
 
+#include <cstddef>
 #include <memory>
 
 /// Line class.
 /// @discussion Models an I²C bus line.
 /// Lines are by default high (pull-up).
 /// Lines are low while one or more nodes (controllers or targets) drive the line low.
+/// Each node that drives the line is identified by a dense slot index.
 class Line
 {
     class Impl;
@@ -25,9 +27,16 @@ public:
     /// Destructor.
     ~Line();
 
+    /// Reserve slots.
+    /// @discussion Subsequent calls to @c set() with a slot less than @c slots do not allocate.
+    void reserve(std::size_t slots);
+
     /// @return Level Line level.
     Level get() const;
 
     /// Set line level.
-    void set(const void * connection, Level level);
+    /// @discussion Idempotent: a slot that drives the line low more than once is counted once.
+    /// @param slot The slot, which must have been reserved.
+    /// @param level The level.
+    void set(std::size_t slot, Level level);
 };
@@ -1,52 +1,367 @@
 #include "log.hpp"
 
-#include <iomanip>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
-namespace
+/// Single-producer, single-consumer ring of records.
+class Log::Ring
 {
+public:
+    /// Number of records.
+    static constexpr std::size_t CAPACITY = 1024;
 
-/// Logging level.
-Log::Level log_level_;
+    /// Records.
+    std::array<Log::Record, CAPACITY> records;
 
-/// Per-thread prefix.
-thread_local std::string prefix_;
+    /// Index of next record to read (written by the drain thread).
+    std::atomic<std::size_t> head;
 
-/// Mutex to prevent multiple threads writing to std::cout simultaneously.
-std::mutex log_mutex_;
+    /// Index of next record to write (written by the logging thread).
+    std::atomic<std::size_t> tail;
 
-} // namespace
+    /// True once the logging thread has exited.
+    std::atomic<bool> closed;
+
+    Ring() : records{}, head{}, tail{}, closed{}
+    {
+    }
+};
+
+/// Formats recorded messages on a background thread.
+class Log::Drain
+{
+    /// This mutex protects the following member variables.
+    std::mutex mutex_;
+
+    /// Rings of all logging threads.
+    std::vector<std::shared_ptr<Ring>> rings_;
+
+    /// Interned prefixes.
+    std::vector<std::string> prefixes_;
+    std::unordered_map<std::string, uint32_t> ids_;
+
+    /// True when the drain thread should exit.
+    bool stopping_;
+
+    /// True when messages have been recorded since the last drain.
+    std::atomic<bool> pending_;
+
+    /// Signalled when messages are pending, or when stopping.
+    std::condition_variable condition_;
+
+    /// This mutex serializes writes to std::cout.
+    std::mutex output_mutex_;
+
+    /// Drain thread.
+    std::thread thread_;
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            condition_.wait(lock, [&]{
+                return pending_.load() || stopping_;
+            });
+            if (stopping_) {
+                return;
+            }
+
+            // Allow a batch to accumulate (unless a ring fills).
+            condition_.wait_for(lock, std::chrono::milliseconds(1));
+
+            pending_ = false;
+            lock.unlock();
+            drain();
+            lock.lock();
+        }
+    }
+
+    static void format(std::string & out, const Record & record)
+    {
+        for (std::size_t i = 0; i < record.size; ) {
+            auto tag = static_cast<Tag>(record.values[i++]);
+            switch (tag) {
+                case Tag::Text: {
+                    auto size = static_cast<uint8_t>(record.values[i++]);
+                    out.append(&record.values[i], size);
+                    i += size;
+                    break;
+                }
+                case Tag::Signed: {
+                    int64_t value;
+                    std::memcpy(&value, &record.values[i], sizeof(value));
+                    out += std::to_string(value);
+                    i += sizeof(value);
+                    break;
+                }
+                case Tag::Unsigned: {
+                    uint64_t value;
+                    std::memcpy(&value, &record.values[i], sizeof(value));
+                    out += std::to_string(value);
+                    i += sizeof(value);
+                    break;
+                }
+                case Tag::Char:
+                    out += record.values[i++];
+                    break;
+                case Tag::Octet: {
+                    int value;
+                    std::memcpy(&value, &record.values[i], sizeof(value));
+                    out += Log::octet(value).view();
+                    i += sizeof(value);
+                    break;
+                }
+            }
+        }
+    }
+
+public:
+    Drain() : mutex_{}, rings_{}, prefixes_{}, ids_{}, stopping_{}, pending_{}, condition_{}, output_mutex_{}, thread_{}
+    {
+        thread_ = std::thread([this]{
+            run();
+        });
+    }
+
+    ~Drain()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        condition_.notify_one();
+        thread_.join();
+
+        drain();
+    }
+
+    std::shared_ptr<Ring> add_ring()
+    {
+        auto ring = std::make_shared<Ring>();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        rings_.push_back(ring);
+        return ring;
+    }
+
+    uint32_t intern(const std::string & prefix)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto [it, inserted] = ids_.emplace(prefix, static_cast<uint32_t>(prefixes_.size()));
+        if (inserted) {
+            prefixes_.push_back(prefix);
+        }
+        return it->second;
+    }
+
+    /// Notify the drain thread that messages are pending.
+    /// @param full True if a ring is full.
+    void notify(bool full)
+    {
+        if (full || (!pending_.load(std::memory_order_relaxed) && !pending_.exchange(true))) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_ = true;
+            condition_.notify_one();
+        }
+    }
+
+    /// Write all recorded messages, in timestamp order.
+    void drain()
+    {
+        std::lock_guard<std::mutex> output(output_mutex_);
+
+        std::vector<std::shared_ptr<Ring>> rings;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            // Discard rings of exited threads once they are empty.
+            rings_.erase(std::remove_if(rings_.begin(), rings_.end(), [](const std::shared_ptr<Ring> & ring){
+                return ring->closed.load() && ring->head.load() == ring->tail.load();
+            }), rings_.end());
+
+            rings = rings_;
+        }
+
+        std::vector<Record> batch;
+        for (auto & ring : rings) {
+            auto head = ring->head.load(std::memory_order_relaxed);
+            auto tail = ring->tail.load(std::memory_order_acquire);
+            for (; head != tail; ++head) {
+                batch.push_back(ring->records[head % Ring::CAPACITY]);
+            }
+            ring->head.store(head, std::memory_order_release);
+        }
+
+        if (batch.empty()) {
+            return;
+        }
+
+        std::stable_sort(batch.begin(), batch.end(), [](const Record & a, const Record & b){
+            return a.timestamp < b.timestamp;
+        });
+
+        std::string out;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (const auto & record : batch) {
+                out += prefixes_[record.prefix];
+                out += '\t';
+                format(out, record);
+                out += '\n';
+            }
+        }
+
+        std::cout << out << std::flush;
+    }
+};
+
+/// Per-thread state.
+struct Log::ThreadState
+{
+    /// Prefix.
+    std::string prefix;
+
+    /// Interned prefix, or -1 if the prefix has changed.
+    int64_t id = -1;
+
+    /// Ring, registered with the drain on first use.
+    std::shared_ptr<Ring> ring;
+
+    ~ThreadState()
+    {
+        if (ring) {
+            ring->closed = true;
+        }
+    }
+};
+
+std::atomic<Log::Level> Log::level_{Log::Level::Debug};
+
+Log::Drain & Log::drain()
+{
+    static Drain drain;
+    return drain;
+}
+
+Log::ThreadState & Log::thread_state()
+{
+    thread_local ThreadState state;
+    return state;
+}
 
 void Log::set_level(Level level)
 {
-    log_level_ = level;
+    level_ = level;
 }
 
 void Log::set_prefix(const std::string & prefix)
 {
-    prefix_ = prefix;
+    auto & state = thread_state();
+    state.prefix = prefix;
+    state.id = -1;
 }
 
-std::string Log::octet(int value)
+std::string Log::prefix()
 {
-    std::stringstream ss;
-    ss << std::setw(2) << std::setfill('0') << std::uppercase << std::hex << value;
-    return ss.str();
+    return thread_state().prefix;
 }
 
-Log::Log(Log::Level level) : level_{level}, ss_{}
+void Log::flush()
 {
-    if (level >= log_level_) {
-        operator<<(prefix_);
-        operator<<('\t');
-    }
+    drain().drain();
+}
+
+Log::Log(Log::Level level) : record_{}
+{
+    record_.level = level;
 }
 
 Log::~Log()
 {
-    if (level_ >= log_level_) {
-        std::lock_guard<std::mutex> lock(log_mutex_);
-        std::cout << ss_.str() << std::endl;
+    auto & state = thread_state();
+    auto & d = drain();
+
+    if (state.id < 0) {
+        state.id = d.intern(state.prefix);
+    }
+    if (!state.ring) {
+        state.ring = d.add_ring();
+    }
+
+    record_.timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    record_.prefix = static_cast<uint32_t>(state.id);
+
+    auto & ring = *state.ring;
+    auto tail = ring.tail.load(std::memory_order_relaxed);
+    while (tail - ring.head.load(std::memory_order_acquire) >= Ring::CAPACITY) {
+        // Full: wait for the drain thread.
+        d.notify(true);
+        std::this_thread::yield();
+    }
+
+    ring.records[tail % Ring::CAPACITY] = record_;
+    ring.tail.store(tail + 1, std::memory_order_release);
+
+    d.notify(false);
+}
+
+void Log::append(Tag tag, const void * data, std::size_t size)
+{
+    if (record_.size + 1 + size > sizeof(record_.values)) {
+        return;
     }
+
+    record_.values[record_.size++] = static_cast<char>(tag);
+    std::memcpy(&record_.values[record_.size], data, size);
+    record_.size = static_cast<uint8_t>(record_.size + size);
+}
+
+void Log::append(const char * text, std::size_t size)
+{
+    // Truncate to fit.
+    auto space = sizeof(record_.values) - record_.size;
+    if (space < 2) {
+        return;
+    }
+    size = std::min(size, space - 2);
+
+    record_.values[record_.size++] = static_cast<char>(Tag::Text);
+    record_.values[record_.size++] = static_cast<char>(size);
+    std::memcpy(&record_.values[record_.size], text, size);
+    record_.size = static_cast<uint8_t>(record_.size + size);
+}
+
+Log & Log::operator<<(const char * msg)
+{
+    append(msg, std::strlen(msg));
+    return *this;
+}
+
+Log & Log::operator<<(const std::string & msg)
+{
+    append(msg.data(), msg.size());
+    return *this;
+}
+
+Log & Log::operator<<(char msg)
+{
+    append(Tag::Char, &msg, sizeof(msg));
+    return *this;
+}
+
+Log & Log::operator<<(const Octet & msg)
+{
+    // Formatted by the drain thread.
+    auto value = msg.value();
+    append(Tag::Octet, &value, sizeof(value));
+    return *this;
 }
@@ -1,37 +1,172 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <type_traits>
+
+/// Minimum log levels, for LOG_LEVEL_MIN.
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO  1
+
+/// Messages below this level are compiled out (see configure.in).
+#ifndef LOG_LEVEL_MIN
+#define LOG_LEVEL_MIN LOG_LEVEL_DEBUG
+#endif
 
 /// Log class.
 /// @discussion Provides logging services.
+/// The level is checked before a message is formatted.  Messages are recorded in a compact binary form to a
+/// per-thread ring, and formatted and written to @c std::cout by a background thread, in timestamp order.
 class Log
 {
 public:
     /// Log level.
-    enum class Level
+    enum class Level : uint8_t
     {
         Debug,
-        Info
+        Info,
+        /// No messages are logged at this level (for set_level()).
+        Off
     };
 
-#define LOG_DEBUG  Log(Log::Level::Debug)
-#define LOG_INFO   Log(Log::Level::Info)
+    /// Minimum level compiled in.
+    static constexpr Level MIN_LEVEL = static_cast<Level>(LOG_LEVEL_MIN);
+
+// Statements below MIN_LEVEL generate no code.  Operands are not evaluated if the level is disabled.
+#define LOG_AT(level) if constexpr ((level) < Log::MIN_LEVEL) {} else if (!Log::enabled(level)) {} else Log(level)
+#define LOG_DEBUG  LOG_AT(Log::Level::Debug)
+#define LOG_INFO   LOG_AT(Log::Level::Info)
+
+    /// Octet formatted as ASCIIHEX, without allocation.
+    class Octet
+    {
+        /// Value.
+        int value_;
+
+        /// Formatted digits (at least two).
+        char text_[2 * sizeof(int)];
+        std::size_t size_;
+
+    public:
+        constexpr explicit Octet(int value) : value_{value}, text_{}, size_{}
+        {
+            auto bits = static_cast<unsigned>(value);
+
+            std::size_t size = 2;
+            while (size < sizeof(text_) && (bits >> (4 * size)) != 0) {
+                size++;
+            }
+
+            for (auto i = size; i > 0; --i) {
+                text_[i - 1] = "0123456789ABCDEF"[bits & 0xF];
+                bits >>= 4;
+            }
+            size_ = size;
+        }
+
+        /// @return int The value.
+        constexpr int value() const
+        {
+            return value_;
+        }
+
+        /// @return std::string_view The formatted value.
+        constexpr std::string_view view() const
+        {
+            return {text_, size_};
+        }
+
+        operator std::string() const
+        {
+            return std::string{view()};
+        }
+
+        friend std::string operator+(const std::string & lhs, const Octet & rhs)
+        {
+            return lhs + std::string{rhs.view()};
+        }
+
+        friend std::string operator+(const char * lhs, const Octet & rhs)
+        {
+            return std::string{lhs} + rhs;
+        }
+    };
 
 private:
-    /// Level of this log message.
-    Level level_;
+    /// Type of each value in a record.
+    enum class Tag : uint8_t
+    {
+        Text,
+        Signed,
+        Unsigned,
+        Char,
+        Octet
+    };
+
+    /// Log message, as recorded.
+    struct Record
+    {
+        /// Steady clock time (ns).
+        uint64_t timestamp;
+
+        /// Interned per-thread prefix.
+        uint32_t prefix;
+
+        /// Level of this log message.
+        Level level;
 
-    /// Output stream.
-    std::stringstream ss_;
+        /// Size of the encoded values.
+        uint8_t size;
+
+        /// Encoded values, each a Tag followed by the value.  (Text is truncated to fit.)
+        char values[114];
+    };
+
+    class Ring;
+    class Drain;
+    struct ThreadState;
+
+    /// @return Drain The drain, constructed on first use.
+    static Drain & drain();
+
+    /// @return ThreadState The state of the calling thread.
+    static ThreadState & thread_state();
+
+    /// Global logging level.
+    static std::atomic<Level> level_;
+
+    /// This log message.
+    Record record_;
+
+    /// Append an encoded value.
+    void append(Tag tag, const void * data, std::size_t size);
+
+    /// Append text.
+    void append(const char * text, std::size_t size);
 
 public:
     /// Set global logging level.
     static void set_level(Level level);
 
+    /// @return bool True if messages at @c level are logged.
+    static bool enabled(Level level)
+    {
+        return level >= level_.load(std::memory_order_relaxed);
+    }
+
     /// Set per-thread prefix.
     static void set_prefix(const std::string & prefix);
 
+    /// @return std::string Per-thread prefix.
+    static std::string prefix();
+
+    /// Write all recorded messages.
+    /// @discussion Messages are otherwise written periodically, and at exit.
+    static void flush();
+
     /// Constructor.
     /// @param level Log level.
     Log(Level level);
@@ -45,16 +180,38 @@ public:
     auto operator=(Log &&) -> Log & = delete;
 
     /// Destructor.
+    /// @discussion Records the message.
     ~Log();
 
+    Log & operator<<(const char * msg);
+
+    Log & operator<<(const std::string & msg);
+
+    Log & operator<<(char msg);
+
+    Log & operator<<(const Octet & msg);
+
     template<class T>
     Log & operator<<(const T & msg)
     {
-        ss_ << msg;
+        if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+            int64_t value = msg;
+            append(Tag::Signed, &value, sizeof(value));
+        } else if constexpr (std::is_integral_v<T>) {
+            uint64_t value = msg;
+            append(Tag::Unsigned, &value, sizeof(value));
+        } else {
+            std::stringstream ss;
+            ss << msg;
+            operator<<(ss.str());
+        }
         return *this;
     }
 
     /// Format an octet as ASCIIHEX.
-    /// @return std::string The formatted value.
-    static std::string octet(int value);
+    /// @return Octet The formatted value, which converts to @c std::string.
+    static constexpr Octet octet(int value)
+    {
+        return Octet{value};
+    }
 };
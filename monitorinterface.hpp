@@ -0,0 +1,28 @@
+#pragma once
+
+#include "bus.hpp"
+
+#include <cstdint>
+
+class Node;
+
+/// Monitor interface class.
+/// @discussion Observes the events processed by a bus.
+/// Monitors attached to a bus are called serially, in the order that events are processed, with the bus state locked:
+/// they must not call back into the bus.
+class MonitorInterface
+{
+public:
+    /// Destructor.
+    virtual ~MonitorInterface() = default;
+
+    /// Event processed.
+    /// @param sequence The bus sequence number.
+    /// @param time The simulated time (ns) of the event (see @c Bus::time()).
+    /// @param handle The handle of the node that caused the event.
+    /// @param node The node that caused the event.
+    /// @param event The event.
+    /// @param sda SDA level after the event.
+    /// @param scl SCL level after the event.
+    virtual void event(uint64_t sequence, uint64_t time, Bus::Handle handle, const Node * node, Bus::Event event, Line::Level sda, Line::Level scl) = 0;
+};
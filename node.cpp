@@ -6,7 +6,7 @@
 class Node::Impl
 {
     /// Back-pointer to parent.
-    /// @discussion Objects of type @c Node are passed across the bus interface in order to identify the node making the request.
+    /// @discussion The node is registered with the bus when attached; subsequent requests are identified by @c handle_.
     Node * parent_;
 
     /// Node name.
@@ -15,15 +15,17 @@ class Node::Impl
     /// Bus that the node is connected to.
     Bus * bus_;
 
+    /// Handle that identifies the node on the bus.
+    Bus::Handle handle_;
+
 public:
-    Impl(Node * node, const std::string & name, Bus * bus) : parent_{node}, name_{name}, bus_{bus}
+    Impl(Node * node, const std::string & name, Bus * bus) : parent_{node}, name_{name}, bus_{bus}, handle_{bus_->attach(parent_)}
     {
-        bus_->attach(parent_);
     }
 
     virtual ~Impl()
     {
-        bus_->detach(parent_);
+        bus_->detach(handle_);
     }
 
     std::string name() const
@@ -33,7 +35,7 @@ public:
 
     Line::Level sda()
     {
-        auto [sda, _] = bus_->get(parent_);
+        auto [sda, _] = bus_->get(handle_);
         return sda;
     }
 
@@ -41,17 +43,17 @@ public:
     {
         switch (level) {
             case Line::Level::Low:
-                bus_->set(parent_, Bus::Event::DataLow);
+                bus_->set(handle_, Bus::Event::DataLow);
                 break;
             case Line::Level::High:
-                bus_->set(parent_, Bus::Event::DataHigh);
+                bus_->set(handle_, Bus::Event::DataHigh);
                 break;
         }
     }
 
     Line::Level scl()
     {
-        auto [_, scl] = bus_->get(parent_);
+        auto [_, scl] = bus_->get(handle_);
         return scl;
     }
 
@@ -59,17 +61,67 @@ public:
     {
         switch (level) {
             case Line::Level::Low:
-                bus_->set(parent_, Bus::Event::ClockLow);
+                bus_->set(handle_, Bus::Event::ClockLow);
                 break;
             case Line::Level::High:
-                bus_->set(parent_, Bus::Event::ClockHigh);
+                bus_->set(handle_, Bus::Event::ClockHigh);
                 break;
         }
     }
 
+    std::tuple<Line::Level, Line::Level> wait_for_sda(Line::Level level)
+    {
+        return bus_->wait_for_edge(handle_, Bus::Signal::SDA, level);
+    }
+
+    std::tuple<Line::Level, Line::Level> wait_for_scl(Line::Level level)
+    {
+        return bus_->wait_for_edge(handle_, Bus::Signal::SCL, level);
+    }
+
+    std::tuple<Line::Level, Line::Level> wait_for_change(Line::Level sda, Line::Level scl)
+    {
+        return bus_->wait_for_change(handle_, sda, scl);
+    }
+
+    bool busy()
+    {
+        return bus_->busy(handle_);
+    }
+
+    void wait_for_idle(std::chrono::steady_clock::time_point deadline)
+    {
+        bus_->wait_for_idle(handle_, deadline);
+    }
+
+    void subscribe()
+    {
+        bus_->subscribe(handle_);
+    }
+
+    void subscribe(uint16_t address)
+    {
+        bus_->subscribe(handle_, address);
+    }
+
+    std::size_t symbols() const
+    {
+        return bus_->symbols(handle_);
+    }
+
+    Detector::Symbol wait_for_symbol()
+    {
+        return bus_->wait_for_symbol(handle_);
+    }
+
+    void wake()
+    {
+        bus_->wake(handle_);
+    }
+
     void delay()
     {
-        bus_->set(parent_, Bus::Event::Delay);
+        bus_->set(handle_, Bus::Event::Delay);
     }
 };
 
@@ -104,6 +156,56 @@ void Node::scl(Line::Level level)
     pimpl->scl(level);
 }
 
+std::tuple<Line::Level, Line::Level> Node::wait_for_sda(Line::Level level)
+{
+    return pimpl->wait_for_sda(level);
+}
+
+std::tuple<Line::Level, Line::Level> Node::wait_for_scl(Line::Level level)
+{
+    return pimpl->wait_for_scl(level);
+}
+
+std::tuple<Line::Level, Line::Level> Node::wait_for_change(Line::Level sda, Line::Level scl)
+{
+    return pimpl->wait_for_change(sda, scl);
+}
+
+Detector::Symbol Node::wait_for_symbol()
+{
+    return pimpl->wait_for_symbol();
+}
+
+void Node::wake()
+{
+    pimpl->wake();
+}
+
+bool Node::busy()
+{
+    return pimpl->busy();
+}
+
+void Node::wait_for_idle(std::chrono::steady_clock::time_point deadline)
+{
+    pimpl->wait_for_idle(deadline);
+}
+
+void Node::subscribe()
+{
+    pimpl->subscribe();
+}
+
+void Node::subscribe(uint16_t address)
+{
+    pimpl->subscribe(address);
+}
+
+std::size_t Node::symbols() const
+{
+    return pimpl->symbols();
+}
+
 void Node::delay()
 {
     pimpl->delay();
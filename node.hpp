@@ -2,6 +2,9 @@
 
 #include "nodeinterface.hpp"
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -44,6 +47,54 @@ public:
     /// @discussion Set clock line to @c level.
     void scl(Line::Level level) override;
 
+    /// Wait for SDA.
+    /// @discussion Block, without polling, until the data line has @c level (or the node is woken).
+    /// @return Line::Level SDA level
+    /// @return Line::Level SCL level
+    std::tuple<Line::Level, Line::Level> wait_for_sda(Line::Level level) override;
+
+    /// Wait for SCL.
+    /// @discussion Block, without polling, until the clock line has @c level (or the node is woken).
+    /// @return Line::Level SDA level
+    /// @return Line::Level SCL level
+    std::tuple<Line::Level, Line::Level> wait_for_scl(Line::Level level) override;
+
+    /// Wait for a change.
+    /// @discussion Block, without polling, until either line differs from @c sda and @c scl (or the node is woken).
+    /// @return Line::Level SDA level
+    /// @return Line::Level SCL level
+    std::tuple<Line::Level, Line::Level> wait_for_change(Line::Level sda, Line::Level scl) override;
+
+    /// Wait for a symbol.
+    /// @discussion Block, without polling, until the bus has decoded a START, STOP or data bit symbol (or the node is woken).
+    /// @return Detector::Symbol The symbol, or Detector::Symbol::None if woken.
+    Detector::Symbol wait_for_symbol() override;
+
+    /// Wake.
+    /// @discussion The current (or next) wait returns immediately.
+    void wake() override;
+
+    /// @return bool True if the bus is busy.
+    /// @discussion See @c Bus::busy().
+    bool busy();
+
+    /// Wait for the bus to be free.
+    /// @discussion See @c Bus::wait_for_idle().
+    /// @param deadline The time at which to stop waiting.
+    void wait_for_idle(std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+    /// Subscribe to symbols.
+    /// @discussion Symbols are buffered from this point, for @c wait_for_symbol().
+    void subscribe();
+
+    /// Subscribe to the symbols of transactions addressed to an address.
+    /// @discussion See @c Bus::subscribe().
+    /// @param address The 7-bit address, or @c Bus::TEN_BIT and the 10-bit address.
+    void subscribe(uint16_t address);
+
+    /// @return std::size_t The number of symbols buffered for @c wait_for_symbol().
+    std::size_t symbols() const;
+
     /// Delay.
     /// @discussion Delay to allow changes to SDA and SCL to propogate to other nodes.
     void delay();
@@ -1,7 +1,10 @@
 #pragma once
 
+#include "detector.hpp"
 #include "line.hpp"
 
+#include <tuple>
+
 /// Node interface class.
 /// @discussion Models a node connected to a I²C bus.
 /// This is a base class used to implement controller and target nodes.
@@ -26,4 +29,31 @@ public:
     /// Set SCL.
     /// @discussion Set clock line to @c level.
     virtual void scl(Line::Level level) = 0;
+
+    /// Wait for SDA.
+    /// @discussion Block, without polling, until the data line has @c level (or the node is woken).
+    /// @return Line::Level SDA level
+    /// @return Line::Level SCL level
+    virtual std::tuple<Line::Level, Line::Level> wait_for_sda(Line::Level level) = 0;
+
+    /// Wait for SCL.
+    /// @discussion Block, without polling, until the clock line has @c level (or the node is woken).
+    /// @return Line::Level SDA level
+    /// @return Line::Level SCL level
+    virtual std::tuple<Line::Level, Line::Level> wait_for_scl(Line::Level level) = 0;
+
+    /// Wait for a change.
+    /// @discussion Block, without polling, until either line differs from @c sda and @c scl (or the node is woken).
+    /// @return Line::Level SDA level
+    /// @return Line::Level SCL level
+    virtual std::tuple<Line::Level, Line::Level> wait_for_change(Line::Level sda, Line::Level scl) = 0;
+
+    /// Wait for a symbol.
+    /// @discussion Block, without polling, until the bus has decoded a START, STOP or data bit symbol (or the node is woken).
+    /// @return Detector::Symbol The symbol, or Detector::Symbol::None if woken.
+    virtual Detector::Symbol wait_for_symbol() = 0;
+
+    /// Wake.
+    /// @discussion The current (or next) wait returns immediately.
+    virtual void wake() = 0;
 };
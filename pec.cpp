@@ -0,0 +1,67 @@
+#include "pec.hpp"
+
+#include <array>
+
+namespace
+{
+
+/// Slicing-by-8 tables: TABLES[k][x] is the CRC of the octet @c x followed by @c k zero octets.
+/// @discussion Since the CRC is linear, the CRC after eight octets d0..d7 from CRC c is
+/// TABLES[7][c ^ d0] ^ TABLES[6][d1] ^ ... ^ TABLES[0][d7].
+constexpr std::array<std::array<uint8_t, 256>, 8> tables()
+{
+    std::array<std::array<uint8_t, 256>, 8> tables{};
+
+    for (unsigned x = 0; x < 256; ++x) {
+        auto crc = x;
+        for (auto bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+        tables[0][x] = static_cast<uint8_t>(crc);
+    }
+
+    for (std::size_t k = 1; k < tables.size(); ++k) {
+        for (unsigned x = 0; x < 256; ++x) {
+            tables[k][x] = tables[0][tables[k - 1][x]];
+        }
+    }
+
+    return tables;
+}
+
+constexpr auto TABLES = tables();
+
+} // namespace
+
+Pec::Pec(uint8_t crc) : crc_{crc}
+{
+}
+
+void Pec::update(uint8_t octet)
+{
+    crc_ = TABLES[0][crc_ ^ octet];
+}
+
+void Pec::update(const uint8_t * data, std::size_t length)
+{
+    crc_ = compute(data, length, crc_);
+}
+
+uint8_t Pec::value() const
+{
+    return crc_;
+}
+
+uint8_t Pec::compute(const uint8_t * data, std::size_t length, uint8_t crc)
+{
+    for (; length >= 8; data += 8, length -= 8) {
+        crc = TABLES[7][crc ^ data[0]] ^ TABLES[6][data[1]] ^ TABLES[5][data[2]] ^ TABLES[4][data[3]]
+            ^ TABLES[3][data[4]] ^ TABLES[2][data[5]] ^ TABLES[1][data[6]] ^ TABLES[0][data[7]];
+    }
+
+    for (; length; ++data, --length) {
+        crc = TABLES[0][crc ^ *data];
+    }
+
+    return crc;
+}
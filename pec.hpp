@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// Pec class.
+/// @discussion Computes the SMBus Packet Error Code: a CRC-8 with polynomial x⁸ + x² + x + 1 (0x07) and initial
+/// value zero, over every octet of a message (including address octets).
+/// Blocks are processed eight octets per step, by slicing-by-8 table lookup, so that checking the PEC of a large
+/// block costs little more than reading it.
+class Pec
+{
+    uint8_t crc_;
+
+public:
+    /// Constructor.
+    /// @param crc The CRC of the preceding octets.
+    explicit Pec(uint8_t crc = 0);
+
+    /// Add an octet.
+    void update(uint8_t octet);
+
+    /// Add octets.
+    void update(const uint8_t * data, std::size_t length);
+
+    /// @return uint8_t The PEC of the octets added.
+    uint8_t value() const;
+
+    /// Compute a PEC.
+    /// @param data The octets.
+    /// @param length The number of octets.
+    /// @param crc The CRC of the preceding octets.
+    /// @return uint8_t The PEC of the preceding octets and @c data.
+    static uint8_t compute(const uint8_t * data, std::size_t length, uint8_t crc = 0);
+};
@@ -0,0 +1,256 @@
+#include "registertarget.hpp"
+
+#include "log.hpp"
+
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class RegisterTarget::Impl
+{
+    /// Back-pointer to parent, for edge-level simulation.
+    RegisterTarget * parent_;
+
+    /// Registers, mapped.
+    uint8_t * registers_;
+    std::size_t size_;
+
+    /// Number of octets of the register index.
+    std::size_t index_octets_;
+
+    /// Register index.
+    std::size_t index_;
+
+    /// Index octets still to be received in the current write, and the index received so far.
+    std::size_t pending_octets_;
+    std::size_t pending_index_;
+
+    /// Hook number (0 for none) indexed by register, allocated when the first hook is attached.
+    std::unique_ptr<uint8_t[]> read_table_;
+    std::unique_ptr<uint8_t[]> write_table_;
+
+    /// Hooks, from hook number 1.
+    std::vector<ReadHook> read_hooks_;
+    std::vector<WriteHook> write_hooks_;
+
+    static uint8_t * map(std::size_t size, const std::string & path)
+    {
+        if (path.empty()) {
+            auto memory = mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) {
+                throw std::system_error(errno, std::generic_category(), "cannot map registers");
+            }
+            return static_cast<uint8_t *>(memory);
+        }
+
+        auto fd = open(path.c_str(), O_RDWR|O_CREAT, 0644);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "cannot open " + path);
+        }
+
+        struct stat st{};
+        void * memory = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && (static_cast<std::size_t>(st.st_size) >= size || ftruncate(fd, static_cast<off_t>(size)) == 0)) {
+            memory = mmap(nullptr, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        auto error = errno;
+        close(fd);
+
+        if (memory == MAP_FAILED) {
+            throw std::system_error(error, std::generic_category(), "cannot map " + path);
+        }
+        return static_cast<uint8_t *>(memory);
+    }
+
+    /// Attach a hook to a range of registers.
+    template <typename Hook>
+    void attach(std::unique_ptr<uint8_t[]> & table, std::vector<Hook> & hooks, std::size_t first, std::size_t count, Hook hook)
+    {
+        if (first > size_ || count > size_ - first) {
+            throw std::out_of_range("register range exceeds registers");
+        }
+        if (hooks.size() == MAX_HOOKS) {
+            throw std::length_error("too many register hooks");
+        }
+
+        if (!table) {
+            table = std::make_unique<uint8_t[]>(size_);
+        }
+
+        hooks.push_back(std::move(hook));
+        for (auto i = first; i < first + count; ++i) {
+            table[i] = static_cast<uint8_t>(hooks.size());
+        }
+    }
+
+    void increment()
+    {
+        if (++index_ == size_) {
+            index_ = 0;
+        }
+    }
+
+public:
+    Impl(RegisterTarget * parent, std::size_t size, std::size_t index_octets, const std::string & path) : parent_{parent}, registers_{}, size_{size}, index_octets_{index_octets}, index_{}, pending_octets_{}, pending_index_{}, read_table_{}, write_table_{}, read_hooks_{}, write_hooks_{}
+    {
+        if (size_ == 0) {
+            throw std::invalid_argument("no registers");
+        }
+        if (index_octets_ == 0 || index_octets_ > sizeof(std::size_t)) {
+            throw std::invalid_argument("invalid register index size");
+        }
+
+        registers_ = map(size_, path);
+    }
+
+    ~Impl()
+    {
+        munmap(registers_, size_);
+    }
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    uint8_t * registers()
+    {
+        return registers_;
+    }
+
+    std::size_t index() const
+    {
+        return index_;
+    }
+
+    void index(std::size_t index)
+    {
+        index_ = index % size_;
+    }
+
+    bool indexing() const
+    {
+        return pending_octets_ != 0;
+    }
+
+    void on_read(std::size_t first, std::size_t count, ReadHook hook)
+    {
+        attach(read_table_, read_hooks_, first, count, std::move(hook));
+    }
+
+    void on_write(std::size_t first, std::size_t count, WriteHook hook)
+    {
+        attach(write_table_, write_hooks_, first, count, std::move(hook));
+    }
+
+    void start(uint8_t octet)
+    {
+        if (!parent_->read_operation(octet)) {
+            pending_octets_ = index_octets_;
+            pending_index_ = 0;
+        }
+    }
+
+    void write(uint8_t octet)
+    {
+        if (pending_octets_) {
+            pending_index_ = pending_index_ << 8 | octet;
+            if (--pending_octets_ == 0) {
+                index_ = pending_index_ % size_;
+                LOG_DEBUG << "index=" << index_;
+            }
+            return;
+        }
+
+        auto hook = write_table_ ? write_table_[index_] : 0;
+        registers_[index_] = hook ? write_hooks_[hook - 1U](index_, octet) : octet;
+        increment();
+    }
+
+    uint8_t read()
+    {
+        auto hook = read_table_ ? read_table_[index_] : 0;
+        auto octet = hook ? read_hooks_[hook - 1U](index_, registers_[index_]) : registers_[index_];
+        increment();
+        return octet;
+    }
+
+    void stop()
+    {
+        pending_octets_ = 0;
+    }
+};
+
+RegisterTarget::RegisterTarget(const std::string & name, uint16_t address, Bus * bus, std::size_t size, std::size_t index_octets, const std::string & path) : TargetBase{name, address, bus}, pimpl{std::make_unique<Impl>(this, size, index_octets, path)}
+{
+}
+
+RegisterTarget::~RegisterTarget() = default;
+
+std::size_t RegisterTarget::size() const
+{
+    return pimpl->size();
+}
+
+uint8_t * RegisterTarget::registers()
+{
+    return pimpl->registers();
+}
+
+std::size_t RegisterTarget::index() const
+{
+    return pimpl->index();
+}
+
+void RegisterTarget::index(std::size_t index)
+{
+    pimpl->index(index);
+}
+
+bool RegisterTarget::indexing() const
+{
+    return pimpl->indexing();
+}
+
+void RegisterTarget::on_read(std::size_t first, std::size_t count, ReadHook hook)
+{
+    pimpl->on_read(first, count, std::move(hook));
+}
+
+void RegisterTarget::on_write(std::size_t first, std::size_t count, WriteHook hook)
+{
+    pimpl->on_write(first, count, std::move(hook));
+}
+
+bool RegisterTarget::edge_level() const
+{
+    return false;
+}
+
+bool RegisterTarget::transaction_start(uint8_t octet)
+{
+    pimpl->start(octet);
+    return true;
+}
+
+bool RegisterTarget::transaction_write(uint8_t octet)
+{
+    pimpl->write(octet);
+    return true;
+}
+
+uint8_t RegisterTarget::transaction_read(bool)
+{
+    return pimpl->read();
+}
+
+void RegisterTarget::transaction_stop()
+{
+    pimpl->stop();
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "targetbase.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+class Bus;
+
+/// Register target class.
+/// @discussion Models an I²C target that exposes a flat array of 8-bit registers (as sensors and EEPROMs do).
+/// A controller write sets the register index (sent MSB first, in one or more octets), then writes registers;
+/// a controller read reads registers from the current index.  The index increments after each register access,
+/// wrapping to zero at the end of the array.
+/// The registers are backed by a memory mapping, either anonymous or of a file (so that the contents persist).
+/// Hooks may be attached to ranges of registers; they are dispatched through a dense table indexed by register.
+/// The target may be simulated at edge level or transaction level, with the same behaviour.
+class RegisterTarget : public TargetBase
+{
+    class Impl;
+    std::unique_ptr<Impl> pimpl;
+
+public:
+    /// Called when a controller reads a register.
+    /// @param index The register index.
+    /// @param value The stored value.
+    /// @return uint8_t The octet to send.
+    using ReadHook = std::function<uint8_t(std::size_t index, uint8_t value)>;
+
+    /// Called when a controller writes a register.
+    /// @param index The register index.
+    /// @param value The octet written by the controller.
+    /// @return uint8_t The value to store.
+    using WriteHook = std::function<uint8_t(std::size_t index, uint8_t value)>;
+
+    /// Maximum number of read hooks (and of write hooks).
+    static constexpr std::size_t MAX_HOOKS = 255;
+
+    /// Constructor.
+    /// @discussion Throws @c std::system_error if the file cannot be mapped.
+    /// @param name The name of the target.
+    /// @param address The 7-bit bus address of the target, or @c Bus::TEN_BIT and the 10-bit address.
+    /// @param bus The bus to connect to.
+    /// @param size The number of registers.
+    /// @param index_octets The number of octets of the register index (1 to sizeof(std::size_t)).
+    /// @param path The file to map (created or extended to @c size if necessary), or empty for anonymous memory (zeroed).
+    RegisterTarget(const std::string & name, uint16_t address, Bus * bus, std::size_t size, std::size_t index_octets = 1, const std::string & path = "");
+
+    /// Destructor.
+    ~RegisterTarget() override;
+
+    /// @return std::size_t The number of registers.
+    std::size_t size() const;
+
+    /// @return uint8_t* The registers.
+    /// @discussion Must not be modified while a controller is accessing the target.
+    uint8_t * registers();
+
+    /// @return std::size_t The current register index.
+    std::size_t index() const;
+
+    /// Set the register index.
+    void index(std::size_t index);
+
+    /// @return bool True while the register index of a controller write is being received.
+    bool indexing() const;
+
+    /// Attach a read hook to a range of registers.
+    /// @discussion Throws @c std::out_of_range if the range exceeds the registers,
+    /// or @c std::length_error if there are too many hooks.
+    void on_read(std::size_t first, std::size_t count, ReadHook hook);
+
+    /// Attach a write hook to a range of registers.
+    /// @discussion As @c on_read().
+    void on_write(std::size_t first, std::size_t count, WriteHook hook);
+
+    /// @return bool False: the target supports transaction-level simulation.
+    bool edge_level() const override;
+
+    /// Start condition.
+    /// @discussion A write begins by setting the register index.
+    /// @return bool True (acknowledged).
+    bool transaction_start(uint8_t octet) override;
+
+    /// Controller write.
+    /// @discussion Sets the register index, then writes the register at the index.
+    /// @return bool True (acknowledged).
+    bool transaction_write(uint8_t octet) override;
+
+    /// Controller read.
+    /// @return uint8_t The register at the index.
+    uint8_t transaction_read(bool nack) override;
+
+    /// Stop condition.
+    void transaction_stop() override;
+};
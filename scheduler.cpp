@@ -0,0 +1,449 @@
+#if defined(__APPLE__)
+// The ucontext API is deprecated (but functional) on macOS.
+#define _XOPEN_SOURCE 600
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+#endif
+
+#include "scheduler.hpp"
+
+#include "log.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#if defined(__SANITIZE_ADDRESS__)
+#define HAS_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define HAS_ASAN 1
+#endif
+#endif
+
+#if defined(HAS_ASAN)
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+namespace
+{
+
+/// Inform the address sanitizer that the stack is about to change.
+void start_switch(void ** fake_stack, const void * bottom, std::size_t size)
+{
+#if defined(HAS_ASAN)
+    __sanitizer_start_switch_fiber(fake_stack, bottom, size);
+#else
+    (void)fake_stack;
+    (void)bottom;
+    (void)size;
+#endif
+}
+
+/// Inform the address sanitizer that the stack has changed.
+void finish_switch(void * fake_stack, const void ** bottom, std::size_t * size)
+{
+#if defined(HAS_ASAN)
+    __sanitizer_finish_switch_fiber(fake_stack, bottom, size);
+#else
+    (void)fake_stack;
+    (void)bottom;
+    (void)size;
+#endif
+}
+
+/// A task stack.
+/// @discussion The stack is mapped, so that pages are only made resident when used, and is preceded by a guard page,
+/// so that an overflow faults instead of corrupting the heap.
+class Stack
+{
+    /// The mapping, including the guard page.
+    void * mapping_;
+    std::size_t length_;
+
+    /// Size of the guard page.
+    std::size_t guard_;
+
+public:
+    /// Constructor.
+    /// @param size The stack size, rounded up to a whole number of pages.
+    explicit Stack(std::size_t size) : mapping_{}, length_{}, guard_{static_cast<std::size_t>(sysconf(_SC_PAGESIZE))}
+    {
+        length_ = guard_ + (size + guard_ - 1) / guard_ * guard_;
+        mapping_ = mmap(nullptr, length_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+        if (mapping_ == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+
+        // Stacks grow down, towards the guard page.
+        if (mprotect(mapping_, guard_, PROT_NONE) != 0) {
+            munmap(mapping_, length_);
+            throw std::bad_alloc();
+        }
+    }
+
+    Stack(const Stack &) = delete;
+    Stack & operator=(const Stack &) = delete;
+
+    ~Stack()
+    {
+        munmap(mapping_, length_);
+    }
+
+    /// @return void* The lowest address of the stack, above the guard page.
+    void * base() const
+    {
+        return static_cast<char *>(mapping_) + guard_;
+    }
+
+    /// @return std::size_t The usable size of the stack.
+    std::size_t size() const
+    {
+        return length_ - guard_;
+    }
+};
+
+} // namespace
+
+struct Scheduler::Task
+{
+    Task(const std::string & name, std::function<void()> function, std::size_t stack_size) : prefix{name}, function{std::move(function)}, stack{stack_size}, context{}, fake_stack{}, done{}, runnable{true}, woken{}, deadline{}
+    {
+    }
+
+    /// Log prefix.
+    std::string prefix;
+
+    /// Task function.
+    std::function<void()> function;
+
+    /// Task stack.
+    Stack stack;
+
+    /// Saved task context.
+    ucontext_t context;
+
+    /// Address sanitizer fake stack, saved while the task is suspended.
+    void * fake_stack;
+
+    /// True once the task function has returned.
+    bool done;
+
+    /// True while the task is runnable: in the ready queue, or running.
+    /// @discussion Protected by the scheduler mutex.
+    bool runnable;
+
+    /// True if the task was woken while runnable, so that its next block() returns at once.
+    /// @discussion Protected by the scheduler mutex.
+    bool woken;
+
+    /// The time at which a blocked task is woken, if it is sleeping.
+    /// @discussion Protected by the scheduler mutex.
+    std::chrono::steady_clock::time_point deadline;
+};
+
+class Scheduler::Impl
+{
+    /// Stack size of each task.
+    std::size_t stack_size_;
+
+    /// Time for which all tasks may be blocked.
+    std::chrono::nanoseconds deadlock_timeout_;
+
+    /// Tasks that have not completed.
+    std::vector<std::unique_ptr<Task>> tasks_;
+
+    /// The running task, or nullptr.
+    Task * current_;
+
+    /// Saved scheduler context.
+    ucontext_t context_;
+
+    /// Scheduler stack, as reported to the address sanitizer.
+    const void * stack_bottom_;
+    std::size_t stack_extent_;
+
+    /// This mutex protects the following member variables, and the runnable and woken flags of tasks.
+    /// @discussion Tasks may be woken from other threads.
+    std::mutex mutex_;
+
+    /// Runnable tasks, in the order that they are resumed.
+    std::deque<Task *> ready_;
+
+    /// Blocked tasks that are woken at their deadline.
+    std::vector<Task *> sleeping_;
+
+    /// Signalled when a task becomes runnable.
+    std::condition_variable condition_;
+
+    /// The exception thrown by a task, if any.
+    std::exception_ptr error_;
+
+    /// Scheduler running on this thread, used to enter new tasks.
+    static thread_local Impl * running_;
+
+    /// Task entry point.
+    static void entry()
+    {
+        auto * self = running_;
+        finish_switch(nullptr, &self->stack_bottom_, &self->stack_extent_);
+
+        // An exception cannot propagate beyond the task stack, so run() rethrows it.
+        try {
+            self->current_->function();
+        } catch (...) {
+            self->error_ = std::current_exception();
+        }
+        self->current_->done = true;
+
+        // Leave the task for the last time: its fake stack may be discarded.
+        start_switch(nullptr, self->stack_bottom_, self->stack_extent_);
+        setcontext(&self->context_);
+    }
+
+    /// Switch from the scheduler to @c task until it yields, blocks or completes.
+    void resume(Task & task)
+    {
+        current_ = &task;
+        Log::set_prefix(task.prefix);
+
+        void * fake_stack{};
+        start_switch(&fake_stack, task.stack.base(), task.stack.size());
+        swapcontext(&context_, &task.context);
+        finish_switch(fake_stack, nullptr, nullptr);
+
+        if (!task.done) {
+            task.prefix = Log::prefix();
+        }
+        current_ = nullptr;
+    }
+
+    /// Switch from the running task to the scheduler.
+    void suspend()
+    {
+        auto & task = *current_;
+
+        start_switch(&task.fake_stack, stack_bottom_, stack_extent_);
+        swapcontext(&task.context, &context_);
+        finish_switch(task.fake_stack, &stack_bottom_, &stack_extent_);
+    }
+
+    /// Make sleeping tasks whose deadline has passed runnable.
+    /// @discussion Caller must hold mutex_.
+    /// @return std::chrono::steady_clock::time_point The earliest deadline of the tasks still sleeping.
+    std::chrono::steady_clock::time_point locked_expire()
+    {
+        auto now = std::chrono::steady_clock::now();
+        auto earliest = std::chrono::steady_clock::time_point::max();
+
+        for (auto it = sleeping_.begin(); it != sleeping_.end(); ) {
+            auto task = *it;
+            if (task->deadline <= now) {
+                task->runnable = true;
+                ready_.push_back(task);
+                it = sleeping_.erase(it);
+            } else {
+                earliest = std::min(earliest, task->deadline);
+                ++it;
+            }
+        }
+        return earliest;
+    }
+
+    /// @return Task* The next runnable task, or nullptr if no task became runnable within the deadlock timeout.
+    Task * next()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        for (;;) {
+            auto earliest = sleeping_.empty() ? std::chrono::steady_clock::time_point::max() : locked_expire();
+            if (!ready_.empty()) {
+                break;
+            }
+
+            // While all tasks are blocked, only another thread, or a deadline, can wake one.
+            if (earliest != std::chrono::steady_clock::time_point::max()) {
+                condition_.wait_until(lock, earliest, [&]{ return !ready_.empty(); });
+            } else if (!condition_.wait_for(lock, deadlock_timeout_, [&]{ return !ready_.empty(); })) {
+                return nullptr;
+            }
+        }
+
+        auto task = ready_.front();
+        ready_.pop_front();
+        return task;
+    }
+
+public:
+    Impl(std::size_t stack_size, std::chrono::nanoseconds deadlock_timeout) : stack_size_{stack_size}, deadlock_timeout_{deadlock_timeout}, tasks_{}, current_{}, context_{}, stack_bottom_{}, stack_extent_{}, mutex_{}, ready_{}, sleeping_{}, condition_{}, error_{}
+    {
+    }
+
+    void spawn(const std::string & name, std::function<void()> function)
+    {
+        auto task = std::make_unique<Task>(name, std::move(function), stack_size_);
+
+        getcontext(&task->context);
+        task->context.uc_stack.ss_sp = task->stack.base();
+        task->context.uc_stack.ss_size = task->stack.size();
+        task->context.uc_link = nullptr;
+        makecontext(&task->context, &Impl::entry, 0);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.push_back(task.get());
+        tasks_.push_back(std::move(task));
+    }
+
+    void run()
+    {
+        auto * previous = running_;
+        running_ = this;
+        auto prefix = Log::prefix();
+        auto deadlock = false;
+
+        while (!tasks_.empty()) {
+            auto task = next();
+            if (!task) {
+                deadlock = true;
+                break;
+            }
+
+            resume(*task);
+
+            if (task->done) {
+                tasks_.erase(std::find_if(tasks_.begin(), tasks_.end(), [task](const std::unique_ptr<Task> & entry) {
+                    return entry.get() == task;
+                }));
+            }
+
+            if (error_) {
+                break;
+            }
+        }
+
+        Log::set_prefix(prefix);
+        running_ = previous;
+
+        if (error_) {
+            std::rethrow_exception(std::exchange(error_, nullptr));
+        }
+
+        if (deadlock) {
+            throw std::runtime_error("deadlock: " + std::to_string(tasks_.size()) + " tasks blocked");
+        }
+    }
+
+    void yield()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ready_.push_back(current_);
+        }
+        suspend();
+    }
+
+    void relinquish()
+    {
+        if (!current_) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (ready_.empty()) {
+                return;
+            }
+            ready_.push_back(current_);
+        }
+        suspend();
+    }
+
+    Task * current() const
+    {
+        return current_;
+    }
+
+    void block(std::chrono::steady_clock::time_point deadline)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (current_->woken) {
+                current_->woken = false;
+                return;
+            }
+            current_->runnable = false;
+
+            if (deadline != std::chrono::steady_clock::time_point::max()) {
+                current_->deadline = deadline;
+                sleeping_.push_back(current_);
+            }
+        }
+        suspend();
+    }
+
+    void wake(Task * task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (task->runnable) {
+                task->woken = true;
+                return;
+            }
+            task->runnable = true;
+            ready_.push_back(task);
+            sleeping_.erase(std::remove(sleeping_.begin(), sleeping_.end(), task), sleeping_.end());
+        }
+        condition_.notify_one();
+    }
+};
+
+thread_local Scheduler::Impl * Scheduler::Impl::running_{};
+
+Scheduler::Scheduler(std::size_t stack_size, std::chrono::nanoseconds deadlock_timeout) : pimpl{std::make_unique<Impl>(stack_size, deadlock_timeout)}
+{
+}
+
+Scheduler::~Scheduler() = default;
+
+void Scheduler::spawn(const std::string & name, std::function<void()> task)
+{
+    pimpl->spawn(name, std::move(task));
+}
+
+void Scheduler::run()
+{
+    pimpl->run();
+}
+
+void Scheduler::yield()
+{
+    pimpl->yield();
+}
+
+void Scheduler::relinquish()
+{
+    pimpl->relinquish();
+}
+
+Scheduler::Task * Scheduler::current() const
+{
+    return pimpl->current();
+}
+
+void Scheduler::block(std::chrono::steady_clock::time_point deadline)
+{
+    pimpl->block(deadline);
+}
+
+void Scheduler::wake(Task * task)
+{
+    pimpl->wake(task);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+/// Scheduler class.
+/// @discussion Runs tasks cooperatively on the calling thread.
+/// Each task has its own stack, and runs until it calls @c yield(), @c relinquish() or @c block().  Runnable tasks
+/// wait in a ready queue, and are resumed in turn (in the order that they became runnable).  A blocked task is not
+/// resumed until it is woken by @c wake(), so blocked tasks cost nothing.  Since there is no preemption, runs are
+/// reproducible.  Stacks are mapped on demand, below a guard page.
+/// A @c Bus constructed with a scheduler blocks a task whose node waits for a condition (the publisher that
+/// satisfies the condition wakes it), yields while a node waits for other nodes to synchronize, and relinquishes
+/// after a node publishes.
+class Scheduler
+{
+    class Impl;
+    std::unique_ptr<Impl> pimpl;
+
+public:
+    /// A task.
+    struct Task;
+
+    /// Default stack size of each task.
+    static constexpr std::size_t DEFAULT_STACK_SIZE = 512 * 1024;
+
+    /// Default time for which all tasks may be blocked, waiting for another thread to wake one, before @c run()
+    /// reports a deadlock.
+    static constexpr std::chrono::nanoseconds DEFAULT_DEADLOCK_TIMEOUT{1000000000};
+
+    /// Constructor.
+    /// @param stack_size The stack size of each task.
+    /// @param deadlock_timeout The time for which all tasks may be blocked.
+    explicit Scheduler(std::size_t stack_size = DEFAULT_STACK_SIZE, std::chrono::nanoseconds deadlock_timeout = DEFAULT_DEADLOCK_TIMEOUT);
+
+    /// Destructor.
+    /// @discussion Tasks that have not completed are discarded without unwinding their stacks.
+    ~Scheduler();
+
+    /// Spawn a task.
+    /// @discussion The task is started by @c run().
+    /// The per-thread log prefix is set to @c name while the task runs.
+    /// @param name The name of the task.
+    /// @param task The task.
+    void spawn(const std::string & name, std::function<void()> task);
+
+    /// Run all tasks until they complete.
+    /// @discussion Tasks may spawn further tasks.
+    /// If a task throws, rethrows the exception.  If all tasks are blocked, and no other thread wakes one within the
+    /// deadlock timeout, throws @c std::runtime_error: the tasks are deadlocked.  Either way, tasks that have not
+    /// completed remain suspended.
+    void run();
+
+    /// Yield to the next runnable task.
+    /// @discussion Must be called from a task, which remains runnable.
+    void yield();
+
+    /// Yield if another task is runnable.
+    /// @discussion Does nothing if not called from a task.  A task that never waits calls this to let others run.
+    void relinquish();
+
+    /// @return Task* The running task, or nullptr if not called from a task.
+    Task * current() const;
+
+    /// Block the running task until it is woken.
+    /// @discussion Must be called from a task.  Returns at once if the task was woken since it last blocked, so a
+    /// wake is not lost; callers check their condition again on return.  A sleeping task (one blocked with a
+    /// deadline) is woken at the deadline, so tasks are not deadlocked while one sleeps.
+    /// @param deadline The time at which to wake the task.
+    void block(std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+    /// Wake a task.
+    /// @discussion May be called from any thread.  A blocked task becomes runnable.
+    void wake(Task * task);
+};
@@ -0,0 +1,284 @@
+#include "smbus.hpp"
+
+#include "controllerbase.hpp"
+#include "log.hpp"
+#include "pec.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+
+class Smbus::Impl
+{
+    ControllerBase * controller_;
+
+    /// True if Packet Error Checking is enabled.
+    bool pec_;
+
+    /// Octets of a write message: command code, length, block and PEC.
+    std::array<uint8_t, 2 + BLOCK_MAX + 1> message_;
+
+    /// Octets of a read message: length, block and PEC.
+    std::array<uint8_t, 1 + BLOCK_MAX + 1> reply_;
+
+    /// @return int The error number of a failed transaction.
+    int error() const
+    {
+        switch (controller_->result()) {
+            case ControllerBase::Result::ARBITRATION_LOST:
+                return -EAGAIN;
+            case ControllerBase::Result::TIMEOUT:
+                return -ETIMEDOUT;
+            default:
+                return -ENXIO;
+        }
+    }
+
+    /// @return bool True if the transaction was abandoned (arbitration was lost, or it timed out).
+    bool abandoned() const
+    {
+        auto result = controller_->result();
+        return result == ControllerBase::Result::ARBITRATION_LOST || result == ControllerBase::Result::TIMEOUT;
+    }
+
+    /// Write the message, and the PEC if enabled.
+    /// @param length The number of octets of the message.
+    int write(uint8_t address, std::size_t length)
+    {
+        if (pec_) {
+            Pec pec;
+            pec.update(static_cast<uint8_t>(address << 1));
+            pec.update(message_.data(), length);
+            message_[length++] = pec.value();
+        }
+
+        return controller_->write(address, message_.data(), length) ? error() : 0;
+    }
+
+    /// Write the message, then read the reply (and the PEC, if enabled) after a repeated START condition.
+    /// @discussion Without a message, the reply is read after a START condition.
+    /// @param length The number of octets of the message.
+    /// @param size The number of octets of the reply.
+    int write_then_read(uint8_t address, std::size_t length, std::size_t size)
+    {
+        auto total = size + (pec_ ? 1 : 0);
+        ControllerBase::Message messages[] = {
+            {address, ControllerBase::MessageFlag::NONE, length, message_.data()},
+            {address, ControllerBase::MessageFlag::READ, total, reply_.data()}
+        };
+
+        auto nack = length ? controller_->transfer(messages, 2) : controller_->transfer(&messages[1], 1);
+        if (nack) {
+            return error();
+        }
+
+        return check(address, length, size);
+    }
+
+    /// Verify the PEC of a message and its reply.
+    /// @return int 0, or -EBADMSG.
+    int check(uint8_t address, std::size_t length, std::size_t size) const
+    {
+        if (!pec_) {
+            return 0;
+        }
+
+        Pec pec;
+        if (length) {
+            pec.update(static_cast<uint8_t>(address << 1));
+            pec.update(message_.data(), length);
+        }
+        pec.update(static_cast<uint8_t>(address << 1 | 1));
+        pec.update(reply_.data(), size);
+
+        if (pec.value() != reply_[size]) {
+            LOG_DEBUG << "PEC error:" << Log::octet(reply_[size]) << " expected:" << Log::octet(pec.value());
+            return -EBADMSG;
+        }
+        return 0;
+    }
+
+    /// @return int The word of the reply, or a negative error number.
+    int word(int result) const
+    {
+        return result ? result : reply_[0] | reply_[1] << 8;
+    }
+
+public:
+    explicit Impl(ControllerBase * controller) : controller_{controller}, pec_{}, message_{}, reply_{}
+    {
+    }
+
+    void pec(bool enable)
+    {
+        pec_ = enable;
+    }
+
+    bool pec() const
+    {
+        return pec_;
+    }
+
+    int write_byte(uint8_t address, uint8_t value)
+    {
+        message_[0] = value;
+        return write(address, 1);
+    }
+
+    int read_byte(uint8_t address)
+    {
+        auto result = write_then_read(address, 0, 1);
+        return result ? result : reply_[0];
+    }
+
+    int write_byte_data(uint8_t address, uint8_t command, uint8_t value)
+    {
+        message_[0] = command;
+        message_[1] = value;
+        return write(address, 2);
+    }
+
+    int read_byte_data(uint8_t address, uint8_t command)
+    {
+        message_[0] = command;
+        auto result = write_then_read(address, 1, 1);
+        return result ? result : reply_[0];
+    }
+
+    int write_word_data(uint8_t address, uint8_t command, uint16_t value)
+    {
+        message_[0] = command;
+        message_[1] = static_cast<uint8_t>(value);
+        message_[2] = static_cast<uint8_t>(value >> 8);
+        return write(address, 3);
+    }
+
+    int read_word_data(uint8_t address, uint8_t command)
+    {
+        message_[0] = command;
+        return word(write_then_read(address, 1, 2));
+    }
+
+    int process_call(uint8_t address, uint8_t command, uint16_t value)
+    {
+        message_[0] = command;
+        message_[1] = static_cast<uint8_t>(value);
+        message_[2] = static_cast<uint8_t>(value >> 8);
+        return word(write_then_read(address, 3, 2));
+    }
+
+    int write_block_data(uint8_t address, uint8_t command, const uint8_t * data, std::size_t length)
+    {
+        if (length > BLOCK_MAX) {
+            return -EINVAL;
+        }
+
+        message_[0] = command;
+        message_[1] = static_cast<uint8_t>(length);
+        std::copy(data, data + length, message_.begin() + 2);
+        return write(address, 2 + length);
+    }
+
+    int read_block_data(uint8_t address, uint8_t command, uint8_t * buffer)
+    {
+        // The length of the reply is only known once its first octet is read.
+        auto write = static_cast<uint8_t>(address << 1);
+        if (controller_->write(write, ControllerBase::WriteFlag::START) || controller_->write(command)
+            || controller_->write(static_cast<uint8_t>(write | 1), ControllerBase::WriteFlag::START)) {
+            auto result = error();
+            controller_->stop();
+            return result;
+        }
+
+        auto length = controller_->read();
+        reply_[0] = length;
+        if (abandoned()) {
+            return error();
+        }
+        // A length octet cannot exceed BLOCK_MAX.
+        if (length == 0) {
+            controller_->read(ControllerBase::ReadFlag::NACK|ControllerBase::ReadFlag::STOP);
+            return -EPROTO;
+        }
+
+        auto size = std::size_t{1} + length;
+        auto total = size + (pec_ ? 1 : 0);
+        for (std::size_t i = 1; i < total; ++i) {
+            reply_[i] = controller_->read(i + 1 == total ? ControllerBase::ReadFlag::NACK|ControllerBase::ReadFlag::STOP : ControllerBase::ReadFlag::NONE);
+        }
+
+        if (abandoned()) {
+            return error();
+        }
+
+        message_[0] = command;
+        auto result = check(address, 1, size);
+        if (result) {
+            return result;
+        }
+
+        std::copy(reply_.begin() + 1, reply_.begin() + static_cast<std::ptrdiff_t>(size), buffer);
+        return length;
+    }
+};
+
+Smbus::Smbus(ControllerBase * controller) : pimpl{std::make_unique<Impl>(controller)}
+{
+}
+
+Smbus::~Smbus() = default;
+
+void Smbus::pec(bool enable)
+{
+    pimpl->pec(enable);
+}
+
+bool Smbus::pec() const
+{
+    return pimpl->pec();
+}
+
+int Smbus::write_byte(uint8_t address, uint8_t value)
+{
+    return pimpl->write_byte(address, value);
+}
+
+int Smbus::read_byte(uint8_t address)
+{
+    return pimpl->read_byte(address);
+}
+
+int Smbus::write_byte_data(uint8_t address, uint8_t command, uint8_t value)
+{
+    return pimpl->write_byte_data(address, command, value);
+}
+
+int Smbus::read_byte_data(uint8_t address, uint8_t command)
+{
+    return pimpl->read_byte_data(address, command);
+}
+
+int Smbus::write_word_data(uint8_t address, uint8_t command, uint16_t value)
+{
+    return pimpl->write_word_data(address, command, value);
+}
+
+int Smbus::read_word_data(uint8_t address, uint8_t command)
+{
+    return pimpl->read_word_data(address, command);
+}
+
+int Smbus::process_call(uint8_t address, uint8_t command, uint16_t value)
+{
+    return pimpl->process_call(address, command, value);
+}
+
+int Smbus::write_block_data(uint8_t address, uint8_t command, const uint8_t * data, std::size_t length)
+{
+    return pimpl->write_block_data(address, command, data, length);
+}
+
+int Smbus::read_block_data(uint8_t address, uint8_t command, uint8_t * buffer)
+{
+    return pimpl->read_block_data(address, command, buffer);
+}
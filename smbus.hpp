@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+class ControllerBase;
+
+/// SMBus class.
+/// @discussion Implements the SMBus protocols (modelled on the Linux @c i2c_smbus_* functions) with an I²C controller.
+/// With Packet Error Checking enabled, a Packet Error Code (see @c Pec) follows the octets written, and is read
+/// and verified after the octets read.
+/// Methods return a non-negative result, or a negative error number:
+/// -ENXIO if an octet was not acknowledged, -EAGAIN if arbitration was lost, -ETIMEDOUT if the transaction timed out,
+/// -EBADMSG if the PEC read was incorrect, -EPROTO if a block read has no octets,
+/// or -EINVAL if the length of a block write exceeds @c BLOCK_MAX.
+class Smbus
+{
+    class Impl;
+    std::unique_ptr<Impl> pimpl;
+
+public:
+    /// Maximum number of octets of a block (SMBus 3).
+    static constexpr std::size_t BLOCK_MAX = 255;
+
+    /// Constructor.
+    /// @param controller The controller, which must outlive the SMBus.
+    explicit Smbus(ControllerBase * controller);
+
+    /// Destructor.
+    ~Smbus();
+
+    /// Enable Packet Error Checking.
+    void pec(bool enable);
+
+    /// @return bool True if Packet Error Checking is enabled.
+    bool pec() const;
+
+    /// Send Byte.
+    /// @param address The 7-bit target address.
+    /// @param value The octet (typically a command code).
+    /// @return int 0, or a negative error number.
+    int write_byte(uint8_t address, uint8_t value);
+
+    /// Receive Byte.
+    /// @return int The octet, or a negative error number.
+    int read_byte(uint8_t address);
+
+    /// Write Byte.
+    /// @param command The command code.
+    /// @return int 0, or a negative error number.
+    int write_byte_data(uint8_t address, uint8_t command, uint8_t value);
+
+    /// Read Byte.
+    /// @return int The octet, or a negative error number.
+    int read_byte_data(uint8_t address, uint8_t command);
+
+    /// Write Word.
+    /// @discussion The low octet is sent first.
+    /// @return int 0, or a negative error number.
+    int write_word_data(uint8_t address, uint8_t command, uint16_t value);
+
+    /// Read Word.
+    /// @return int The word, or a negative error number.
+    int read_word_data(uint8_t address, uint8_t command);
+
+    /// Process Call.
+    /// @discussion Writes a word, then reads a word after a repeated START condition.
+    /// @return int The word read, or a negative error number.
+    int process_call(uint8_t address, uint8_t command, uint16_t value);
+
+    /// Block Write.
+    /// @discussion Sends the length, then the octets.
+    /// @param data The octets.
+    /// @param length The number of octets (at most @c BLOCK_MAX).
+    /// @return int 0, or a negative error number.
+    int write_block_data(uint8_t address, uint8_t command, const uint8_t * data, std::size_t length);
+
+    /// Block Read.
+    /// @discussion Reads the length, then the octets.
+    /// @param buffer The buffer for octets read, of at least @c BLOCK_MAX octets.
+    /// @return int The number of octets read (1 to @c BLOCK_MAX), or a negative error number.
+    int read_block_data(uint8_t address, uint8_t command, uint8_t * buffer);
+};
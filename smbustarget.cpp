@@ -0,0 +1,293 @@
+#include "smbustarget.hpp"
+
+#include "log.hpp"
+#include "pec.hpp"
+#include "smbus.hpp"
+
+#include <array>
+#include <atomic>
+
+class SmbusTarget::Impl
+{
+    /// Back-pointer to parent, for edge-level simulation.
+    SmbusTarget * parent_;
+
+    /// True if reads are followed by a PEC.
+    bool pec_;
+
+    /// Protocol, value and Process Call hook of each command code.
+    std::array<Protocol, 256> protocols_;
+    std::array<std::vector<uint8_t>, 256> values_;
+    std::array<ProcessCall, 256> hooks_;
+
+    std::atomic<uint64_t> pec_errors_;
+
+    /// True from a START condition to the STOP condition.
+    bool started_;
+
+    /// Selected command code, and true if it was written in the current transaction.
+    uint8_t command_;
+    bool commanded_;
+
+    /// Octets written after the command code.
+    std::vector<uint8_t> data_;
+
+    /// CRC of the octets of the transaction before data_.
+    Pec crc_;
+
+    /// True once a correct PEC follows the data; true if the write was rejected.
+    bool checked_;
+    bool rejected_;
+
+    /// Octets to send, and the number sent.
+    std::vector<uint8_t> reply_;
+    std::size_t sent_;
+
+    /// @return std::size_t The number of octets written after the command code, before the PEC.
+    std::size_t expected() const
+    {
+        switch (protocols_[command_]) {
+            case Protocol::Byte:
+                return 1;
+            case Protocol::Block:
+                // The length octet, then the block.
+                return data_.empty() ? 1 : 1 + std::size_t{data_[0]};
+            default:
+                return 2;
+        }
+    }
+
+    /// Prepare the reply to a read.
+    void reply()
+    {
+        const auto & value = values_[command_];
+        reply_.clear();
+        sent_ = 0;
+
+        if (!commanded_) {
+            // Receive Byte.
+            reply_.push_back(value.empty() ? uint8_t{0xFF} : value[0]);
+        } else if (protocols_[command_] == Protocol::Block) {
+            reply_.push_back(static_cast<uint8_t>(value.size()));
+            reply_.insert(reply_.end(), value.begin(), value.end());
+        } else if (protocols_[command_] == Protocol::ProcessCall) {
+            auto word = data_.size() == 2 ? static_cast<uint16_t>(data_[0] | data_[1] << 8) : uint16_t{};
+            word = hooks_[command_] ? hooks_[command_](command_, word) : uint16_t{0xFFFF};
+            reply_.push_back(static_cast<uint8_t>(word));
+            reply_.push_back(static_cast<uint8_t>(word >> 8));
+        } else {
+            reply_ = value;
+        }
+
+        if (pec_) {
+            reply_.push_back(Pec::compute(reply_.data(), reply_.size(), crc_.value()));
+        }
+    }
+
+public:
+    explicit Impl(SmbusTarget * parent) : parent_{parent}, pec_{}, protocols_{}, values_{}, hooks_{}, pec_errors_{}, started_{}, command_{}, commanded_{}, data_{}, crc_{}, checked_{}, rejected_{}, reply_{}, sent_{}
+    {
+        values_.fill({0x00});
+        data_.reserve(Smbus::BLOCK_MAX + 1);
+        reply_.reserve(Smbus::BLOCK_MAX + 2);
+    }
+
+    void pec(bool enable)
+    {
+        pec_ = enable;
+    }
+
+    void command(uint8_t command, Protocol protocol)
+    {
+        protocols_[command] = protocol;
+        hooks_[command] = nullptr;
+        switch (protocol) {
+            case Protocol::Byte:
+                values_[command] = {0x00};
+                break;
+            case Protocol::Word:
+                values_[command] = {0x00, 0x00};
+                break;
+            default:
+                values_[command].clear();
+                break;
+        }
+    }
+
+    void command(uint8_t command, ProcessCall hook)
+    {
+        this->command(command, Protocol::ProcessCall);
+        hooks_[command] = std::move(hook);
+    }
+
+    const std::vector<uint8_t> & value(uint8_t command) const
+    {
+        return values_[command];
+    }
+
+    void value(uint8_t command, const std::vector<uint8_t> & value)
+    {
+        values_[command] = value;
+    }
+
+    uint64_t pec_errors() const
+    {
+        return pec_errors_;
+    }
+
+    void start(uint8_t octet)
+    {
+        if (!started_) {
+            started_ = true;
+            commanded_ = false;
+            rejected_ = false;
+            crc_ = Pec{};
+        } else {
+            // The PEC covers every octet from the START condition, across repeated START conditions.
+            crc_.update(data_.data(), data_.size());
+        }
+
+        crc_.update(octet);
+        if (parent_->read_operation(octet)) {
+            reply();
+        }
+
+        data_.clear();
+        checked_ = false;
+    }
+
+    bool write(uint8_t octet)
+    {
+        if (rejected_) {
+            return false;
+        }
+
+        if (!commanded_) {
+            command_ = octet;
+            commanded_ = true;
+            crc_.update(octet);
+            return true;
+        }
+
+        if (data_.size() < expected()) {
+            data_.push_back(octet);
+            return true;
+        }
+
+        // The PEC, or an octet after it.
+        if (checked_ || octet != Pec::compute(data_.data(), data_.size(), crc_.value())) {
+            LOG_DEBUG << "PEC error:" << Log::octet(octet);
+
+            if (!checked_) {
+                ++pec_errors_;
+            }
+            rejected_ = true;
+            return false;
+        }
+
+        checked_ = true;
+        return true;
+    }
+
+    uint8_t read()
+    {
+        return sent_ < reply_.size() ? reply_[sent_++] : uint8_t{0xFF};
+    }
+
+    /// Complete a write, at the STOP condition.
+    void commit()
+    {
+        if (pec_ && !checked_) {
+            // Send Byte, whose PEC follows the command code, or a write without its PEC.
+            if (data_.size() != 1 || data_[0] != crc_.value()) {
+                LOG_DEBUG << "PEC error";
+                ++pec_errors_;
+            }
+            return;
+        }
+
+        if (data_.size() != expected() || protocols_[command_] == Protocol::ProcessCall) {
+            return;
+        }
+
+        LOG_DEBUG << "command " << Log::octet(command_) << " written";
+
+        if (protocols_[command_] == Protocol::Block) {
+            values_[command_].assign(data_.begin() + 1, data_.end());
+        } else {
+            values_[command_] = data_;
+        }
+    }
+
+    void stop()
+    {
+        if (started_ && commanded_ && !rejected_ && !data_.empty()) {
+            commit();
+        }
+
+        started_ = false;
+        data_.clear();
+    }
+};
+
+SmbusTarget::SmbusTarget(const std::string & name, uint16_t address, Bus * bus) : TargetBase{name, address, bus}, pimpl{std::make_unique<Impl>(this)}
+{
+}
+
+SmbusTarget::~SmbusTarget() = default;
+
+void SmbusTarget::pec(bool enable)
+{
+    pimpl->pec(enable);
+}
+
+void SmbusTarget::command(uint8_t command, Protocol protocol)
+{
+    pimpl->command(command, protocol);
+}
+
+void SmbusTarget::command(uint8_t command, ProcessCall hook)
+{
+    pimpl->command(command, std::move(hook));
+}
+
+const std::vector<uint8_t> & SmbusTarget::value(uint8_t command) const
+{
+    return pimpl->value(command);
+}
+
+void SmbusTarget::value(uint8_t command, const std::vector<uint8_t> & value)
+{
+    pimpl->value(command, value);
+}
+
+uint64_t SmbusTarget::pec_errors() const
+{
+    return pimpl->pec_errors();
+}
+
+bool SmbusTarget::edge_level() const
+{
+    return false;
+}
+
+bool SmbusTarget::transaction_start(uint8_t octet)
+{
+    pimpl->start(octet);
+    return true;
+}
+
+bool SmbusTarget::transaction_write(uint8_t octet)
+{
+    return pimpl->write(octet);
+}
+
+uint8_t SmbusTarget::transaction_read(bool)
+{
+    return pimpl->read();
+}
+
+void SmbusTarget::transaction_stop()
+{
+    pimpl->stop();
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "targetbase.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Bus;
+
+/// SMBus target class.
+/// @discussion Models an SMBus device whose command codes select values, written and read with the SMBus protocols
+/// (see @c Smbus).  The protocol of each command code sets the length of its value: Byte (the default), Word,
+/// Block, or Process Call (whose hook computes the word read from the word written).
+/// Send Byte selects a command code, whose value Receive Byte then reads (the first octet of it).
+/// A write may be followed by a Packet Error Code, which is verified: a write with an incorrect PEC is not
+/// acknowledged and is discarded.  Written values take effect at the STOP condition.
+/// With PEC enabled, the target appends a PEC to each read, and discards writes without a PEC (a Send Byte is then
+/// the command code and its PEC).
+/// The target may be simulated at edge level or transaction level, with the same behaviour.
+class SmbusTarget : public TargetBase
+{
+    class Impl;
+    std::unique_ptr<Impl> pimpl;
+
+public:
+    /// SMBus protocol of a command code.
+    enum class Protocol
+    {
+        Byte,
+        Word,
+        Block,
+        ProcessCall
+    };
+
+    /// Computes the word read by a Process Call.
+    /// @param command The command code.
+    /// @param value The word written by the controller.
+    /// @return uint16_t The word to send.
+    using ProcessCall = std::function<uint16_t(uint8_t command, uint16_t value)>;
+
+    /// Constructor.
+    /// @param name The name of the target.
+    /// @param address The 7-bit bus address of the target.
+    /// @param bus The bus to connect to.
+    SmbusTarget(const std::string & name, uint16_t address, Bus * bus);
+
+    /// Destructor.
+    ~SmbusTarget() override;
+
+    /// Enable Packet Error Checking.
+    /// @discussion Reads are followed by a PEC, and writes must be.  Otherwise, writes are checked if the controller sends a PEC.
+    void pec(bool enable);
+
+    /// Set the protocol of a command code.
+    /// @discussion The value is cleared (to zero, or to no octets for a block).
+    void command(uint8_t command, Protocol protocol);
+
+    /// Make a command code a Process Call.
+    void command(uint8_t command, ProcessCall hook);
+
+    /// @return std::vector<uint8_t> The value of a command code (a word is stored low octet first).
+    const std::vector<uint8_t> & value(uint8_t command) const;
+
+    /// Set the value of a command code.
+    void value(uint8_t command, const std::vector<uint8_t> & value);
+
+    /// @return uint64_t The number of writes discarded for an incorrect (or missing) PEC.
+    uint64_t pec_errors() const;
+
+    /// @return bool False: the target supports transaction-level simulation.
+    bool edge_level() const override;
+
+    /// Start condition.
+    /// @discussion A read prepares the reply (and its PEC).
+    /// @return bool True (acknowledged).
+    bool transaction_start(uint8_t octet) override;
+
+    /// Controller write.
+    /// @return bool False if the octet is an incorrect PEC, or follows the PEC.
+    bool transaction_write(uint8_t octet) override;
+
+    /// Controller read.
+    /// @return uint8_t The next octet of the reply.
+    uint8_t transaction_read(bool nack) override;
+
+    /// Stop condition.
+    /// @discussion A complete write takes effect.
+    void transaction_stop() override;
+};
@@ -5,119 +5,134 @@
 #include "node.hpp"
 #include "targetbase.hpp"
 
-#include <atomic>
-
 class Target::Impl : public TargetBase
 {
-    std::atomic_bool running_;
+    /// Next octet to send in response to a transaction-level controller read.
+    uint8_t data_;
 
 public:
-    Impl(const std::string & name, uint8_t address, Bus * bus) : TargetBase{name, address, bus}, running_{}
+    Impl(const std::string & name, uint16_t address, Bus * bus) : TargetBase{name, address, bus}, data_{}
     {
     }
 
-    void stop()
+    /// @return bool True if the target stretches the clock.
+    /// @discussion The example target at address 0x53 (first octet 0xA6) stretches the clock.
+    bool clock_stretching() const
     {
-        running_ = false;
+        return address() == 0x53;
     }
 
-    void run()
+    /// @return bool True if the target stretches the clock, which requires edge-level simulation.
+    bool edge_level() const override
     {
-        running_ = true;
-        for (;;) {
-            while (sda() == Line::Level::High) {
-                if (!running_) {
-                    return;
-                }
-            }
-            // Falling edge SDA ▔\▁
-            isr();
-        }
+        return clock_stretching();
     }
 
-    void isr()
+    bool transaction_start(uint8_t octet) override
     {
-        if (scl() == Line::Level::Low) {
-            return;
-        }
+        LOG_DEBUG << "START";
+        LOG_DEBUG << "rx address=" << Log::octet(octet);
 
-        // SCL ▔\▁
-        while (scl() == Line::Level::High) {
+        if (read_operation(octet)) {
+            data_ = static_cast<uint8_t>(address() << 4);
         }
+        return true;
+    }
 
-        LOG_DEBUG << "START";
+    bool transaction_write(uint8_t octet) override
+    {
+        LOG_INFO << "rx=" << Log::octet(octet);
+        return true;
+    }
 
-        auto [result, octet] = read();
-        switch (result) {
-            case TargetBase::Result::Octet:
-                break;
-            case TargetBase::Result::Stop:
-            case TargetBase::Result::Start:
-                return;
-        }
+    uint8_t transaction_read(bool nack) override
+    {
+        LOG_INFO << "tx:" << Log::octet(data_);
+        LOG_DEBUG << "nack=" << nack;
+        return data_++;
+    }
 
-        LOG_DEBUG << "rx address=" << Log::octet(octet);
+    void transaction_stop() override
+    {
+    }
 
-        if (!address_match(octet)) {
-            wait_for_condition(WaitFlag::STOP);
-            return;
-        }
+    /// Serve transactions at edge level, after a START condition.
+    void serve() override
+    {
+        // SCL ▔▔▔▔
+        // SDA ▔▔\▁
 
-        ack();
+        // A repeated START condition begins a further transaction.
+        for (auto restart = true; restart; ) {
+            LOG_DEBUG << "START";
 
-        if (read_operation(octet)) {
-            handle_controller_read();
-        } else {
-            handle_controller_write();
+            auto [result, octet, match] = read_address();
+            switch (result) {
+                case TargetBase::Result::Octet:
+                    break;
+                case TargetBase::Result::Start:
+                    continue;
+                case TargetBase::Result::Stop:
+                    return;
+            }
+
+            LOG_DEBUG << "rx address=" << Log::octet(octet);
+
+            if (!match) {
+                restart = wait_for_condition(WaitFlag::START|WaitFlag::STOP) == Condition::START;
+                continue;
+            }
+
+            ack();
+
+            if (read_operation(octet)) {
+                restart = handle_controller_read();
+            } else {
+                restart = handle_controller_write();
+            }
         }
     }
 
     /// Write data in response to a controller read operation.
     /// @discussion First octet is based on our address, and auto increments.
     /// There is no limit to how much data may be read.
-    void handle_controller_read()
+    /// @return bool True if the controller sent a repeated START condition.
+    bool handle_controller_read()
     {
         for (uint8_t data = static_cast<uint8_t>(address() << 4); ; data++) {
             LOG_INFO << "tx:" << Log::octet(data);
             write(data);
 
-            // SCL ▁/▔
-            while (scl() == Line::Level::Low) {
-            }
-
-            if (address() == 0xA6) {
-                // Drive SCL low for clock stretching *before* sampling SDA.
+            if (clock_stretching()) {
+                // Drive SCL low for clock stretching *before* the controller samples the ACK.
                 // A target might implement this in order to reserve time to prepare the next octet.
                 LOG_DEBUG << "tx clock stretch";
                 scl(Line::Level::Low);
-            }
-
-            auto nack = sda();
-
-            if (address() == 0xA6) {
-                scl(Line::Level::Low);
-                scl(Line::Level::Low);
-                scl(Line::Level::Low);
+                delay();
+                delay();
+                delay();
                 LOG_DEBUG << "tx clock stretch end";
                 scl(Line::Level::High);
             }
 
-            // SCL ▔\▁
-            while (scl() == Line::Level::High) {
-            }
+            auto symbol = wait_for_symbol();
+            auto nack = symbol != Detector::Symbol::Bit0;
 
             LOG_DEBUG << "nack=" << static_cast<int>(nack);
 
-            if (nack == Line::Level::High) {
-                wait_for_condition(WaitFlag::START|WaitFlag::STOP);
-                return;
+            if (nack) {
+                if (symbol == Detector::Symbol::Bit1) {
+                    return wait_for_condition(WaitFlag::START|WaitFlag::STOP) == Condition::START;
+                }
+                return symbol == Detector::Symbol::Start || symbol == Detector::Symbol::RepeatedStart;
             }
         }
     }
 
     /// Read data in response to a controller write operation.
     /// @discussion The data is logged and discarded.
-    void handle_controller_write()
+    /// @return bool True if the controller sent a repeated START condition.
+    bool handle_controller_write()
     {
         for (;;) {
             auto [result, octet] = read();
@@ -125,11 +140,12 @@ public:
                 case TargetBase::Result::Octet:
                     break;
                 case TargetBase::Result::Stop:
+                    return false;
                 case TargetBase::Result::Start:
-                    return;
+                    return true;
             }
 
-            if (address() == 0xA6) {
+            if (clock_stretching()) {
                 // Drive SCL low for clock stretching *before* driving SDA low for the ACK.
                 // (SDA must be valid before controller sees SCL go high.)
                 // A target might implement this in order to reserve time to process the request.
@@ -140,10 +156,10 @@ public:
             // Drive SDA low to acknowledge.
             sda(Line::Level::Low);
 
-            if (address() == 0xA6) {
-                scl(Line::Level::Low);
-                scl(Line::Level::Low);
-                scl(Line::Level::Low);
+            if (clock_stretching()) {
+                delay();
+                delay();
+                delay();
                 LOG_DEBUG << "rx clock stretch end";
                 scl(Line::Level::High);
             }
@@ -159,7 +175,7 @@ public:
     }
 };
 
-Target::Target(const std::string & name, uint8_t address, Bus * bus) : pimpl{std::make_unique<Impl>(name, address, bus)}
+Target::Target(const std::string & name, uint16_t address, Bus * bus) : pimpl{std::make_unique<Impl>(name, address, bus)}
 {
 }
 
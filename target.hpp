@@ -7,7 +7,7 @@
 class Bus;
 
 /// Target class.
-/// @discussion Models a generic I²C target having a 7-bit address on the I²C bus.
+/// @discussion Models a generic I²C target having a 7-bit or 10-bit address on the I²C bus.
 /// The private implementation inherits from class @c Node which provides methods to interact with the bus.
 /// This example target accepts read and write operations.
 class Target
@@ -18,9 +18,9 @@ class Target
 public:
     /// Constructor.
     /// @param name The name of the target.
-    /// @param address The 7-bit bus address of the target.
+    /// @param address The 7-bit bus address of the target, or @c Bus::TEN_BIT and the 10-bit address.
     /// @param bus The bus to connect to.
-    Target(const std::string & name, uint8_t address, Bus * bus);
+    Target(const std::string & name, uint16_t address, Bus * bus);
 
     /// Destructor.
     ~Target();
@@ -30,5 +30,6 @@ public:
     void run();
 
     /// Stop the "main loop".
+    /// @discussion May be called before @c run(), which then returns immediately.
     void stop();
 };
@@ -4,25 +4,46 @@
 #include "log.hpp"
 #include "node.hpp"
 
+#include <atomic>
+
 class TargetBase::Impl : public Node
 {
-    /// Bus address (7-bit).
-    uint8_t address_;
+    /// Back-pointer to parent.
+    /// @discussion Registered with the bus for transaction-level simulation.
+    TargetBase * parent_;
+
+    /// Bus that the target is connected to.
+    Bus * bus_;
+
+    /// Bus address (7-bit, or Bus::TEN_BIT and 10-bit).
+    uint16_t address_;
+
+    /// True if the target was addressed by a 10-bit write, so that a 10-bit read after a repeated START condition continues.
+    bool addressed_;
+
+    /// Cleared by stop(), from any thread.
+    std::atomic_bool running_;
 
 public:
-    Impl(const std::string & name, uint8_t address, Bus * bus) : Node{name, bus}, address_{address}
+    Impl(TargetBase * target, const std::string & name, uint16_t address, Bus * bus) : Node{name, bus}, parent_{target}, bus_{bus}, address_{address}, addressed_{}, running_{true}
+    {
+        subscribe(address_);
+        bus_->attach(parent_, address_);
+    }
+
+    ~Impl() override
     {
+        bus_->detach(parent_);
     }
 
-    uint8_t address() const
+    uint16_t address() const
     {
-        return address_;
+        return address_ & static_cast<uint16_t>(~Bus::TEN_BIT);
     }
 
-    bool address_match(uint8_t octet) const
+    bool ten_bit() const
     {
-        auto address_bits = octet >> 1;
-        return address_bits == address();
+        return (address_ & Bus::TEN_BIT) == Bus::TEN_BIT;
     }
 
     std::tuple<Result, uint8_t> read()
@@ -31,30 +52,24 @@ public:
 
         uint8_t octet{};
 
-        for (int shift = 7; shift >= 0; shift--) {
-            // SCL ▁/▔
-            while (scl() == Line::Level::Low) {
-            }
-
-            auto level = sda();
-
-            octet <<= 1;
-            if (level == Line::Level::High) {
-                octet |= 1;
-            }
-
-            while (scl() == Line::Level::High) {
-                if (level == Line::Level::Low && sda() == Line::Level::High) {
-                    // SCL ▁/▔▔▔
-                    // SDA ▁▁▁/▔
-                    LOG_DEBUG << "read=STOP";
-                    return {Result::Stop, {}};
-                } else if (level == Line::Level::High && sda() == Line::Level::Low) {
-                    // SCL ▁/▔▔▔
-                    // SDA ▔▔▔\▁
+        for (int bits = 0; bits < 8; ) {
+            switch (wait_for_symbol()) {
+                case Detector::Symbol::Bit0:
+                    octet <<= 1;
+                    bits++;
+                    break;
+                case Detector::Symbol::Bit1:
+                    octet = static_cast<uint8_t>(octet << 1 | 1);
+                    bits++;
+                    break;
+                case Detector::Symbol::Start:
+                case Detector::Symbol::RepeatedStart:
                     LOG_DEBUG << "read=START";
                     return {Result::Start, {}};
-                }
+                case Detector::Symbol::Stop:
+                case Detector::Symbol::None:
+                    LOG_DEBUG << "read=STOP";
+                    return {Result::Stop, {}};
             }
         }
 
@@ -62,6 +77,45 @@ public:
         return {Result::Octet, octet};
     }
 
+    std::tuple<Result, uint8_t, bool> read_address()
+    {
+        auto [result, octet] = read();
+        if (result != Result::Octet) {
+            return {result, octet, false};
+        }
+
+        if (!ten_bit()) {
+            return {result, octet, (octet >> 1) == address()};
+        }
+
+        auto prefix = static_cast<uint8_t>(0xF0 | (address() >> 7 & 0x06));
+        if (octet == (prefix | 1)) {
+            return {result, octet, addressed_};
+        }
+
+        addressed_ = false;
+        if (octet != prefix) {
+            return {result, octet, false};
+        }
+
+        if (symbols()) {
+            // Another target acknowledged the first octet: the bus delivered the address when it was complete.
+            wait_for_clock_pulse();
+        } else {
+            ack();
+        }
+
+        auto [second_result, second] = read();
+        if (second_result != Result::Octet) {
+            return {second_result, octet, false};
+        }
+
+        LOG_DEBUG << "rx address=" << Log::octet(second);
+
+        addressed_ = second == (address() & 0xFF);
+        return {result, octet, addressed_};
+    }
+
     void ack()
     {
         // Drive SDA low to acknowledge.
@@ -91,58 +145,140 @@ public:
 
     void wait_for_clock_pulse()
     {
-        while (scl() == Line::Level::Low) {
+        for (;;) {
+            switch (wait_for_symbol()) {
+                case Detector::Symbol::Bit0:
+                case Detector::Symbol::Bit1:
+                case Detector::Symbol::None:
+                    return;
+                default:
+                    break;
+            }
         }
+    }
+
+    void run()
+    {
+        // Checked before waiting too, since a wait within serve() may have returned for stop().
+        while (running_) {
+            auto symbol = wait_for_symbol();
+            if (!running_) {
+                return;
+            }
 
-        while (scl() == Line::Level::High) {
+            if (symbol == Detector::Symbol::Start || symbol == Detector::Symbol::RepeatedStart) {
+                parent_->serve();
+            }
         }
     }
 
-    TargetBase::Condition wait_for_condition(TargetBase::WaitFlag flags)
+    void stop()
     {
-        LOG_DEBUG << "wait_for_condition";
+        running_ = false;
+        wake();
+    }
+
+    void serve()
+    {
+        auto addressed = false;
+
+        // A repeated START condition begins a further transaction.
+        for (auto restart = true; restart; ) {
+            auto [result, octet, match] = read_address();
+            if (result == Result::Start) {
+                continue;
+            }
+            if (result == Result::Stop) {
+                break;
+            }
+
+            if (!match || !parent_->transaction_start(octet)) {
+                restart = wait_for_condition(WaitFlag::START|WaitFlag::STOP) == Condition::START;
+                continue;
+            }
+
+            addressed = true;
+            ack();
+            restart = parent_->read_operation(octet) ? controller_read() : controller_write();
+        }
+
+        if (addressed) {
+            parent_->transaction_stop();
+        }
+    }
+
+    /// Send octets until the controller does not acknowledge.
+    /// @return bool True if the controller sent a repeated START condition.
+    bool controller_read()
+    {
+        for (;;) {
+            write(parent_->transaction_read(false));
+
+            auto symbol = wait_for_symbol();
+            if (symbol == Detector::Symbol::Bit1) {
+                return wait_for_condition(WaitFlag::START|WaitFlag::STOP) == Condition::START;
+            }
+            if (symbol != Detector::Symbol::Bit0) {
+                return symbol == Detector::Symbol::Start || symbol == Detector::Symbol::RepeatedStart;
+            }
+        }
+    }
 
+    /// Receive octets until a START or STOP condition, or an octet that is not acknowledged.
+    /// @return bool True if the controller sent a repeated START condition.
+    bool controller_write()
+    {
         for (;;) {
-            auto level = sda();
+            auto [result, octet] = read();
+            if (result != Result::Octet) {
+                return result == Result::Start;
+            }
 
-            while (scl() == Line::Level::Low) {
-                level = sda();
+            if (!parent_->transaction_write(octet)) {
+                return wait_for_condition(WaitFlag::START|WaitFlag::STOP) == Condition::START;
             }
+            ack();
+        }
+    }
 
-            while (scl() == Line::Level::High) {
-                if (level == Line::Level::Low && sda() == Line::Level::High) {
-                    // SCL ▁/▔▔▔
-                    // SDA ▁▁▁/▔
+    TargetBase::Condition wait_for_condition(TargetBase::WaitFlag flags)
+    {
+        LOG_DEBUG << "wait_for_condition";
+
+        for (;;) {
+            switch (wait_for_symbol()) {
+                case Detector::Symbol::Stop:
+                case Detector::Symbol::None:
                     LOG_DEBUG << "wait_for_condition=STOP";
                     return TargetBase::Condition::STOP;
-
-                } else if (flags & TargetBase::WaitFlag::START) {
-                    if (level == Line::Level::High && sda() == Line::Level::Low) {
-                        // SCL ▁/▔▔▔
-                        // SDA ▔▔▔\▁
+                case Detector::Symbol::Start:
+                case Detector::Symbol::RepeatedStart:
+                    if (flags & TargetBase::WaitFlag::START) {
                         LOG_DEBUG << "wait_for_condition=START";
                         return TargetBase::Condition::START;
                     }
-                }
+                    break;
+                default:
+                    break;
             }
         }
     }
 };
 
-TargetBase::TargetBase(const std::string & name, uint8_t address, Bus * bus) : pimpl{std::make_unique<Impl>(name, address, bus)}
+TargetBase::TargetBase(const std::string & name, uint16_t address, Bus * bus) : pimpl{std::make_unique<Impl>(this, name, address, bus)}
 {
 }
 
 TargetBase::~TargetBase() = default;
 
-uint8_t TargetBase::address() const
+uint16_t TargetBase::address() const
 {
     return pimpl->address();
 }
 
-bool TargetBase::address_match(uint8_t octet) const
+bool TargetBase::ten_bit() const
 {
-    return pimpl->address_match(octet);
+    return pimpl->ten_bit();
 }
 
 bool TargetBase::read_operation(uint8_t octet) const
@@ -150,6 +286,30 @@ bool TargetBase::read_operation(uint8_t octet) const
     return (octet & 0x01) != 0;
 }
 
+bool TargetBase::edge_level() const
+{
+    return true;
+}
+
+bool TargetBase::transaction_start(uint8_t)
+{
+    return false;
+}
+
+bool TargetBase::transaction_write(uint8_t)
+{
+    return false;
+}
+
+uint8_t TargetBase::transaction_read(bool)
+{
+    return 0xFF;
+}
+
+void TargetBase::transaction_stop()
+{
+}
+
 void TargetBase::ack()
 {
     pimpl->ack();
@@ -160,6 +320,11 @@ std::tuple<TargetBase::Result, uint8_t> TargetBase::read()
     return pimpl->read();
 }
 
+std::tuple<TargetBase::Result, uint8_t, bool> TargetBase::read_address()
+{
+    return pimpl->read_address();
+}
+
 void TargetBase::write(uint8_t octet)
 {
     pimpl->write(octet);
@@ -170,6 +335,21 @@ void TargetBase::wait_for_clock_pulse()
     pimpl->wait_for_clock_pulse();
 }
 
+void TargetBase::serve()
+{
+    pimpl->serve();
+}
+
+void TargetBase::run()
+{
+    pimpl->run();
+}
+
+void TargetBase::stop()
+{
+    pimpl->stop();
+}
+
 TargetBase::Condition TargetBase::wait_for_condition(TargetBase::WaitFlag flags)
 {
     return pimpl->wait_for_condition(flags);
@@ -195,3 +375,32 @@ void TargetBase::scl(Line::Level level)
     pimpl->scl(level);
 }
 
+std::tuple<Line::Level, Line::Level> TargetBase::wait_for_sda(Line::Level level)
+{
+    return pimpl->wait_for_sda(level);
+}
+
+std::tuple<Line::Level, Line::Level> TargetBase::wait_for_scl(Line::Level level)
+{
+    return pimpl->wait_for_scl(level);
+}
+
+std::tuple<Line::Level, Line::Level> TargetBase::wait_for_change(Line::Level sda, Line::Level scl)
+{
+    return pimpl->wait_for_change(sda, scl);
+}
+
+Detector::Symbol TargetBase::wait_for_symbol()
+{
+    return pimpl->wait_for_symbol();
+}
+
+void TargetBase::wake()
+{
+    pimpl->wake();
+}
+
+void TargetBase::delay()
+{
+    pimpl->delay();
+}
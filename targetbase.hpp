@@ -2,6 +2,7 @@
 
 #include "bitmask_operators.hpp"
 #include "nodeinterface.hpp"
+#include "transactioninterface.hpp"
 
 #include <memory>
 #include <string>
@@ -10,7 +11,9 @@ class Bus;
 
 /// Target base class.
 /// @discussion Models an I²C target at an address on the I²C bus.
-class TargetBase : public NodeInterface
+/// By default the target is simulated at edge level; derived classes that override the transaction-level callbacks
+/// (and @c edge_level()) may also be simulated at transaction level.
+class TargetBase : public NodeInterface, public TransactionInterface
 {
     class Impl;
     std::unique_ptr<Impl> pimpl;
@@ -18,18 +21,18 @@ class TargetBase : public NodeInterface
 public:
     /// Constructor.
     /// @param name The name of the target.
-    /// @param address The 7-bit bus address of the target.
+    /// @param address The 7-bit bus address of the target, or @c Bus::TEN_BIT and the 10-bit address.
     /// @param bus The bus to connect to.
-    TargetBase(const std::string & name, uint8_t address, Bus * bus);
+    TargetBase(const std::string & name, uint16_t address, Bus * bus);
 
     /// Destructor.
     ~TargetBase() override;
 
-    /// @return uint8_t I²C bus address of node.
-    uint8_t address() const;
+    /// @return uint16_t I²C bus address of node (without @c Bus::TEN_BIT).
+    uint16_t address() const;
 
-    /// @return bool True if the address portion of the first octet matches.
-    bool address_match(uint8_t octet) const;
+    /// @return bool True if the address is a 10-bit address.
+    bool ten_bit() const;
 
     /// @return bool True if the R/W' bit in the first octet indicates a read operation.
     bool read_operation(uint8_t octet) const;
@@ -42,13 +45,22 @@ public:
     };
 
     /// Read octet.
-    /// @discussion For each bit (from MSB to LSB) this function samples SDA when the
-    /// controller has driven SCL high.
-    /// This function samples SDA while SCL is high, in order to detect a STOP or RESTART condition.
+    /// @discussion Consumes eight data bit symbols (from MSB to LSB) decoded by the bus.
+    /// A START or STOP symbol ends the read early (as does waking the target, which is reported as a STOP).
     /// @return Result Result.
     /// @return uint8_t Octet.
     std::tuple<Result, uint8_t> read();
 
+    /// Read address.
+    /// @discussion Reads the first octet after a START condition and, for a 10-bit address, the second octet.
+    /// The first octet of a 10-bit address (11110XX0) is acknowledged here (unless another target acknowledged it);
+    /// a 10-bit read (11110XX1, after a repeated START condition) matches if the target was addressed by the
+    /// preceding 10-bit write.  The caller acknowledges a matching address.
+    /// @return Result Result.
+    /// @return uint8_t The first octet.
+    /// @return bool True if the address matches.
+    std::tuple<Result, uint8_t, bool> read_address();
+
     /// Acknowledge.
     /// @discussion Drive SDA low to acknowledge an octet written by the controller.
     /// Wait for controller to sample SDA (by detecting a clock pulse), then drive SDA high again.
@@ -61,7 +73,7 @@ public:
     void write(uint8_t octet);
 
     /// Await clock pulse.
-    /// @discussion Wait for SCL low->high->low ▁/▔\▁ pulse.
+    /// @discussion Wait for SCL low->high->low ▁/▔\▁ pulse, which completes a data bit symbol.
     void wait_for_clock_pulse();
 
     enum class WaitFlag : unsigned
@@ -80,8 +92,44 @@ public:
     /// Detect STOP condition.
     /// @discussion The STOP condition is defined as SCL HIGH then SDA going HIGH.
     /// SDA only changes when SCL is high for START and STOP conditions.
+    /// Data bit symbols are skipped; waking the target is reported as a STOP.
     Condition wait_for_condition(WaitFlag flags);
 
+    /// Serve transactions at edge level through the transaction-level callbacks.
+    /// @discussion Called after a START condition, until the STOP condition.  Each transaction (after the START or
+    /// a repeated START condition) that addresses the target begins with @c transaction_start(), which acknowledges
+    /// the address.  Then @c transaction_write() acknowledges each octet written by the controller, or
+    /// @c transaction_read() provides each octet read until the controller does not acknowledge one.
+    /// @c transaction_stop() ends the transactions, if the target was addressed.
+    /// A derived class may override this to serve transactions at edge level itself.
+    virtual void serve();
+
+    /// Runs the "main loop" for edge-level simulation.
+    /// @discussion Calls @c serve() after each START condition.  This method must be called from a unique thread.
+    void run();
+
+    /// Stop the "main loop".
+    /// @discussion May be called before @c run(), which then returns immediately.
+    void stop();
+
+    /// @return bool True, since by default the target does not implement the transaction-level callbacks.
+    bool edge_level() const override;
+
+    /// Start condition.
+    /// @return bool False (not acknowledged).
+    bool transaction_start(uint8_t octet) override;
+
+    /// Controller write.
+    /// @return bool False (not acknowledged).
+    bool transaction_write(uint8_t octet) override;
+
+    /// Controller read.
+    /// @return uint8_t 0xFF (SDA pulled up).
+    uint8_t transaction_read(bool nack) override;
+
+    /// Stop condition.
+    void transaction_stop() override;
+
     /// Get SDA.
     /// @return int Data line level.
     Line::Level sda() override;
@@ -97,6 +145,37 @@ public:
     /// Set SCL.
     /// @discussion Set clock line to @c level.
     void scl(Line::Level level) override;
+
+    /// Wait for SDA.
+    /// @discussion Block, without polling, until the data line has @c level (or the node is woken).
+    /// @return Line::Level SDA level
+    /// @return Line::Level SCL level
+    std::tuple<Line::Level, Line::Level> wait_for_sda(Line::Level level) override;
+
+    /// Wait for SCL.
+    /// @discussion Block, without polling, until the clock line has @c level (or the node is woken).
+    /// @return Line::Level SDA level
+    /// @return Line::Level SCL level
+    std::tuple<Line::Level, Line::Level> wait_for_scl(Line::Level level) override;
+
+    /// Wait for a change.
+    /// @discussion Block, without polling, until either line differs from @c sda and @c scl (or the node is woken).
+    /// @return Line::Level SDA level
+    /// @return Line::Level SCL level
+    std::tuple<Line::Level, Line::Level> wait_for_change(Line::Level sda, Line::Level scl) override;
+
+    /// Wait for a symbol.
+    /// @discussion Block, without polling, until the bus has decoded a START, STOP or data bit symbol (or the node is woken).
+    /// @return Detector::Symbol The symbol, or Detector::Symbol::None if woken.
+    Detector::Symbol wait_for_symbol() override;
+
+    /// Wake.
+    /// @discussion The current (or next) wait returns immediately.
+    void wake() override;
+
+    /// Delay.
+    /// @discussion Advances the simulated time of the bus (for example, while stretching the clock).
+    void delay();
 };
 
 BITMASK_OPERATORS(TargetBase::WaitFlag)
@@ -1,10 +1,32 @@
+#include "asynccontroller.hpp"
 #include "bus.hpp"
+#include "busfarm.hpp"
 #include "controllerbase.hpp"
+#include "decoder.hpp"
+#include "eeprom.hpp"
 #include "log.hpp"
+#include "node.hpp"
+#include "pec.hpp"
+#include "registertarget.hpp"
+#include "scheduler.hpp"
+#include "smbus.hpp"
+#include "smbustarget.hpp"
 #include "target.hpp"
+#include "trace.hpp"
+#include "watchdog.hpp"
 
 #include "xassert.hpp"
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
 #include <thread>
 #include <vector>
 
@@ -150,41 +172,75 @@ void test_write(ControllerBase & controller, uint8_t address)
     xassert(!nack);
 }
 
-} // namespace
+void test_register_read_burst(ControllerBase & controller, uint8_t address)
+{
+    LOG_INFO << "[ read address " << Log::octet(address) << " register (write then read) ]";
 
-int main()
+    const uint8_t reg[] = {0xAD};
+    uint8_t data[4]{};
+
+    auto nack = controller.write_then_read(address, reg, sizeof reg, data, sizeof data);
+    xassert(!nack);
+    xassert(data[0] == 0x00);
+    xassert(data[1] == 0x01);
+    xassert(data[2] == 0x02);
+    xassert(data[3] == 0x03);
+}
+
+void test_write_burst(ControllerBase & controller, uint8_t address)
 {
-    Log::set_level(Log::Level::Info);
+    LOG_INFO << "[ write burst to address " << Log::octet(address) << " ]";
 
-    Bus bus;
+    const uint8_t data[] = {0x01, 0x02, 0x03};
 
-    std::vector<std::unique_ptr<Target>> targets{};
-    std::vector<std::thread> threads{};
+    auto nack = controller.write(address, data, sizeof data);
+    xassert(!nack);
+}
 
-#define N_TARGETS 4
+void test_read_burst(ControllerBase & controller, uint8_t address, uint8_t expected)
+{
+    LOG_INFO << "[ read burst from address " << Log::octet(address) << " ]";
 
-    for (auto i = 0; i < N_TARGETS; ++i) {
-        auto address = static_cast<uint8_t>(0x50 + i);
-        auto name = "T" + Log::octet(address);
+    uint8_t data[2]{};
 
-        auto t = std::make_unique<Target>(name, address, &bus);
-        auto n = targets.size();
-        targets.push_back(std::move(t));
+    auto nack = controller.read(address, data, sizeof data);
+    xassert(!nack);
+    xassert(data[0] == expected);
+    xassert(data[1] == expected + 1);
+}
 
-        auto thr = std::thread([&targets, n, name]
-        {
-            Log::set_prefix(name);
+void test_transfer_nonexistent_target(ControllerBase & controller, uint8_t address)
+{
+    LOG_INFO << "[ transfer to non-existent address " << Log::octet(address) << " ]";
 
-            targets[n]->run();
-        });
+    uint8_t data[1]{0x42};
+    ControllerBase::Message messages[] = {
+        {address, ControllerBase::MessageFlag::NONE, sizeof data, data},
+        {address, ControllerBase::MessageFlag::READ, sizeof data, data}
+    };
 
-        threads.push_back(std::move(thr));
-    }
+    auto nack = controller.transfer(messages, 2);
+    xassert(!!nack);
+    xassert(data[0] == 0x42);
+}
 
-    auto name = "C00";
-    Log::set_prefix(name);
-    ControllerBase controller(name, &bus);
+void test_transfer_switch(ControllerBase & controller, uint8_t address, uint8_t other)
+{
+    LOG_INFO << "[ transfer to " << Log::octet(address) << " then " << Log::octet(other) << " after repeated START ]";
+
+    uint8_t data[2]{0x42, 0x43};
+    ControllerBase::Message messages[] = {
+        {address, ControllerBase::MessageFlag::NONE, 1, data},
+        {other, ControllerBase::MessageFlag::READ, sizeof data, data}
+    };
 
+    auto nack = controller.transfer(messages, 2);
+    xassert(!nack);
+    xassert(data[0] == static_cast<uint8_t>(other << 4) && data[1] == static_cast<uint8_t>((other << 4) + 1));
+}
+
+void test_suite(ControllerBase & controller)
+{
     test_register_read(controller, 0x50);
     test_write_simple(controller, 0x51);
     test_write_multi(controller, 0x52);
@@ -195,12 +251,1311 @@ int main()
     // Clock stretching.
     test_write(controller, 0x53);
     test_read(controller, 0x53, 0x30);
+    test_register_read_burst(controller, 0x50);
+    test_write_burst(controller, 0x52);
+    test_read_burst(controller, 0x51, 0x10);
+    test_read_burst(controller, 0x53, 0x30);
+    test_transfer_nonexistent_target(controller, 0x20);
+    test_transfer_switch(controller, 0x51, 0x52);
+}
+
+#define N_TARGETS 4
+
+/// Runs targets on their own threads.
+class TargetThreads
+{
+    std::vector<std::unique_ptr<Target>> targets_;
+    std::vector<std::thread> threads_;
+
+public:
+    TargetThreads(Bus & bus) : targets_{}, threads_{}
+    {
+        for (auto i = 0; i < N_TARGETS; ++i) {
+            auto address = static_cast<uint8_t>(0x50 + i);
+            targets_.push_back(std::make_unique<Target>("T" + Log::octet(address), address, &bus));
+        }
+
+        for (auto i = 0; i < N_TARGETS; ++i) {
+            auto name = "T" + Log::octet(0x50 + i);
+            auto target = targets_[static_cast<std::size_t>(i)].get();
+
+            threads_.emplace_back([target, name]
+            {
+                Log::set_prefix(name);
+
+                target->run();
+            });
+        }
+    }
+
+    ~TargetThreads()
+    {
+        for (auto & target : targets_) {
+            target->stop();
+        }
+
+        for (auto & thread : threads_) {
+            thread.join();
+        }
+    }
+};
+
+void test_threaded(bool transaction_level)
+{
+    LOG_INFO << (transaction_level ? "[ threaded, transaction-level ]" : "[ threaded ]");
+
+    Bus bus;
+    bus.transaction_level(transaction_level);
+
+    TargetThreads targets(bus);
+
+    auto name = "C00";
+    Log::set_prefix(name);
+    ControllerBase controller(name, &bus);
+
+    test_suite(controller);
+}
+
+void test_wait_policy(Bus::WaitPolicy policy)
+{
+    static const char * const names[] = {"spin", "spin, yield", "park"};
+    LOG_INFO << "[ wait policy: " << names[static_cast<int>(policy)] << " ]";
+
+    Bus bus;
+    bus.wait_policy(policy);
+    xassert(bus.wait_policy() == policy);
+
+    RegisterTarget target("T50", 0x50, &bus, 256);
+    std::thread thread([&]
+    {
+        target.run();
+    });
+
+    ControllerBase controller("C00", &bus);
+    const uint8_t data[] = {0x10, 0xA5, 0x5A};
+    xassert(!controller.write(0x50, data, sizeof data));
+
+    uint8_t buffer[2]{};
+    xassert(!controller.write_then_read(0x50, data, 1, buffer, sizeof buffer));
+    xassert(buffer[0] == 0xA5 && buffer[1] == 0x5A);
+
+    // Waiting threads spin for about as long as a publish takes.
+    xassert(bus.statistics().publish_time > 0);
+
+    target.stop();
+    thread.join();
+}
+
+void test_async()
+{
+    LOG_INFO << "[ asynchronous ]";
+
+    Bus bus;
+    TargetThreads targets(bus);
+
+    AsyncController controller("A00", &bus);
+
+    // Producer threads queue transactions concurrently.
+    using Result = ControllerBase::Result;
+    std::future<Result> writes[2];
+    std::future<std::tuple<Result, std::vector<uint8_t>>> reads[2];
+
+    std::thread producer([&]
+    {
+        writes[0] = controller.write(0x51, {0x01, 0x02});
+        reads[0] = controller.read(0x52, 2);
+    });
+
+    writes[1] = controller.write(0x20, {0x03});
+    reads[1] = controller.write_then_read(0x50, {0xAD}, 3);
+
+    producer.join();
+
+    xassert(writes[0].get() == Result::ACK);
+    xassert(writes[1].get() == Result::NACK);
+
+    auto [result, data] = reads[0].get();
+    xassert(result == Result::ACK);
+    xassert(data == (std::vector<uint8_t>{0x20, 0x21}));
+
+    std::tie(result, data) = reads[1].get();
+    xassert(result == Result::ACK);
+    xassert(data == (std::vector<uint8_t>{0x00, 0x01, 0x02}));
+
+    std::promise<Result> completed;
+    controller.submit([](ControllerBase & c)
+    {
+        return c.write(0x53 << 1, ControllerBase::WriteFlag::START|ControllerBase::WriteFlag::STOP);
+    }, [&](Result result, std::exception_ptr error)
+    {
+        xassert(!error);
+        completed.set_value(result);
+    });
+    xassert(completed.get_future().get() == Result::ACK);
+
+    // Exceptions do not escape the controller thread.
+    auto throws = [](ControllerBase &) -> bool
+    {
+        throw std::runtime_error("transaction");
+    };
+
+    auto thrown = false;
+    try {
+        controller.submit(throws).get();
+    } catch (const std::runtime_error &) {
+        thrown = true;
+    }
+    xassert(thrown);
+
+    std::promise<std::exception_ptr> failed;
+    controller.submit(throws, [&](Result, std::exception_ptr error)
+    {
+        failed.set_value(error);
+        throw std::runtime_error("completion");
+    });
+    xassert(failed.get_future().get());
+    xassert(controller.write(0x51, {0x03}).get() == Result::ACK);
+}
+
+void test_cooperative()
+{
+    LOG_INFO << "[ cooperative ]";
+
+    Scheduler scheduler;
+    Bus bus(&scheduler);
+
+    std::vector<std::unique_ptr<Target>> targets{};
+
+    for (auto i = 0; i < N_TARGETS; ++i) {
+        auto address = static_cast<uint8_t>(0x50 + i);
+        auto name = "T" + Log::octet(address);
+
+        auto t = std::make_unique<Target>(name, address, &bus);
+        auto target = t.get();
+        targets.push_back(std::move(t));
+
+        scheduler.spawn(name, [target]
+        {
+            target->run();
+        });
+    }
+
+    ControllerBase controller("C00", &bus);
+
+    scheduler.spawn("C00", [&]
+    {
+        test_suite(controller);
+
+        for (auto & target : targets) {
+            target->stop();
+        }
+    });
+
+    scheduler.run();
+}
+
+void test_farm()
+{
+    LOG_INFO << "[ farm ]";
+
+    constexpr int N_BUSES = 3;
+
+    // More buses than workers.
+    BusFarm farm(2);
+    xassert(farm.workers() == 2);
+
+    std::vector<std::unique_ptr<Target>> targets{};
+    std::vector<std::unique_ptr<ControllerBase>> controllers{};
+
+    for (auto b = 0; b < N_BUSES; ++b) {
+        auto bus = farm.add_bus();
+        auto prefix = "B" + std::to_string(b) + ".";
+
+        std::vector<Target *> bus_targets{};
+        for (auto i = 0; i < N_TARGETS; ++i) {
+            auto address = static_cast<uint8_t>(0x50 + i);
+            auto name = prefix + "T" + Log::octet(address);
+
+            targets.push_back(std::make_unique<Target>(name, address, bus));
+            auto target = targets.back().get();
+            bus_targets.push_back(target);
+
+            farm.spawn(bus, name, [target]
+            {
+                target->run();
+            });
+        }
+
+        auto name = prefix + "C00";
+        controllers.push_back(std::make_unique<ControllerBase>(name, bus));
+        auto controller = controllers.back().get();
+
+        farm.spawn(bus, name, [controller, bus_targets]
+        {
+            test_suite(*controller);
+
+            for (auto target : bus_targets) {
+                target->stop();
+            }
+        });
+    }
+
+    farm.run();
+}
+
+void test_deadlock()
+{
+    LOG_INFO << "[ deadlock ]";
+
+    // Nodes are constructed outside the tasks, since the stacks of deadlocked tasks are not unwound.
+    {
+        Scheduler scheduler(Scheduler::DEFAULT_STACK_SIZE, std::chrono::milliseconds(10));
+        Bus bus(&scheduler);
+        Node waiter("W", &bus);
+
+        // Nothing drives SDA low, so the task never returns.
+        scheduler.spawn("W", [&] { waiter.wait_for_sda(Line::Level::Low); });
+
+        auto deadlocked = false;
+        try {
+            scheduler.run();
+        } catch (const std::runtime_error & e) {
+            LOG_INFO << e.what();
+            deadlocked = true;
+        }
+        xassert(deadlocked);
+    }
+
+    {
+        BusFarm farm(1);
+        auto bus = farm.add_bus();
+        Node waiter("W", bus);
+
+        farm.spawn(bus, "W", [&] { waiter.wait_for_sda(Line::Level::Low); });
+
+        auto deadlocked = false;
+        try {
+            farm.run();
+        } catch (const std::runtime_error & e) {
+            LOG_INFO << e.what();
+            deadlocked = true;
+        }
+        xassert(deadlocked);
+    }
+}
+
+void test_task_exception()
+{
+    LOG_INFO << "[ task exception ]";
+
+    Scheduler scheduler;
+    Bus bus(&scheduler, 1);
+    Node node("A", &bus);
+
+    // The bus is full.
+    scheduler.spawn("B", [&] { Node other("B", &bus); });
+
+    auto thrown = false;
+    try {
+        scheduler.run();
+    } catch (const std::length_error & e) {
+        LOG_INFO << e.what();
+        thrown = true;
+    }
+    xassert(thrown);
+}
+
+void test_trace()
+{
+    LOG_INFO << "[ trace ]";
+
+    const std::string path = "test_i2c.vcd";
+    constexpr std::size_t CAPACITY = 64;
+    uint64_t time{};
+
+    {
+        Scheduler scheduler;
+        Bus bus(&scheduler);
+
+        // Small buffers, to exercise the writer thread.
+        Trace trace(path, CAPACITY);
+        bus.attach(&trace);
+
+        Target target("T50", 0x50, &bus);
+        ControllerBase controller("C00", &bus);
+
+        scheduler.spawn("T50", [&]
+        {
+            target.run();
+        });
+
+        scheduler.spawn("C00", [&]
+        {
+            test_register_read(controller, 0x50);
+            target.stop();
+        });
+
+        scheduler.run();
+        bus.detach(&trace);
+        time = bus.time();
+    }
+
+    // Timestamps are the simulated time, in ns.
+    std::ifstream file(path);
+    std::string line;
+    auto definitions = false;
+    auto timescale = false;
+    std::size_t times = 0;
+    uint64_t last = 0;
+    while (std::getline(file, line)) {
+        if (line == "$enddefinitions $end") {
+            definitions = true;
+        } else if (line == "$timescale 1 ns $end") {
+            timescale = true;
+        } else if (line[0] == '#') {
+            auto timestamp = std::stoull(line.substr(1));
+            xassert(times == 0 || timestamp > last);
+            last = timestamp;
+            times++;
+        }
+    }
+    xassert(definitions && timescale);
+    xassert(times > 2 * CAPACITY);
+    xassert(last == time);
+
+    std::remove(path.c_str());
+}
+
+void test_decoder()
+{
+    LOG_INFO << "[ decoder ]";
+
+    struct Expected
+    {
+        Decoder::Kind kind;
+        uint8_t octet;
+        const char * node;
+    };
+
+    using Kind = Decoder::Kind;
+    const Expected expected[] = {
+        {Kind::Start, 0, "C00"},
+        {Kind::Address, 0xA0, "C00"},
+        {Kind::Ack, 0, "T50"},
+        {Kind::Data, 0xAD, "C00"},
+        {Kind::Ack, 0, "T50"},
+        {Kind::RepeatedStart, 0, "C00"},
+        {Kind::Address, 0xA1, "C00"},
+        {Kind::Ack, 0, "T50"},
+        {Kind::Data, 0x00, "T50"},
+        {Kind::Ack, 0, "C00"},
+        {Kind::Data, 0x01, "T50"},
+        {Kind::Ack, 0, "C00"},
+        {Kind::Data, 0x02, "T50"},
+        {Kind::Ack, 0, "C00"},
+        {Kind::Data, 0x03, "T50"},
+        {Kind::Nack, 0, nullptr},
+        {Kind::Stop, 0, "C00"},
+    };
+
+    std::size_t count = 0;
+    uint64_t sequence = 0;
+    Decoder decoder([&](const Decoder::Record & record)
+    {
+        xassert(count < std::size(expected));
+        const auto & e = expected[count++];
+        xassert(record.kind == e.kind);
+        xassert(record.octet == e.octet);
+        xassert(e.node ? record.node && record.node->name() == e.node : !record.node);
+        xassert(record.sequence >= sequence);
+        sequence = record.sequence;
+    });
+
+    Scheduler scheduler;
+    Bus bus(&scheduler);
+    bus.attach(&decoder);
+
+    Target target("T50", 0x50, &bus);
+    ControllerBase controller("C00", &bus);
+
+    scheduler.spawn("T50", [&]
+    {
+        target.run();
+    });
+
+    scheduler.spawn("C00", [&]
+    {
+        test_register_read(controller, 0x50);
+        target.stop();
+    });
+
+    scheduler.run();
+    bus.detach(&decoder);
+
+    xassert(count == std::size(expected));
+}
+
+void test_statistics()
+{
+    LOG_INFO << "[ statistics ]";
+
+    Histogram histogram;
+    xassert(histogram.percentile(50) == 0);
+    for (uint64_t value = 1; value <= 1000; ++value) {
+        histogram.record(value);
+    }
+    xassert(histogram.count() == 1000);
+    xassert(histogram.percentile(0) == 1);
+    // Within one sub-bucket of the true value.
+    xassert(histogram.percentile(50) <= 500 && histogram.percentile(50) > 500 - 500 / Histogram::SUB_BUCKETS);
+    xassert(Histogram::lowest(Histogram::bucket(1000)) <= 1000);
+    xassert(Histogram::bucket(~uint64_t{}) == Histogram::BUCKETS - 1);
+
+    Bus bus;
+    bus.latency_histograms(true);
+    xassert(bus.latency_histograms());
+
+    {
+        TargetThreads targets(bus);
+
+        Log::set_prefix("C00");
+        ControllerBase controller("C00", &bus);
+        test_register_read(controller, 0x50);
+
+        auto statistics = bus.statistics();
+        xassert(statistics.events > 0);
+        xassert(statistics.latency.size() == N_TARGETS + 1);
+
+        std::size_t publishers = 0;
+        for (const auto & latency : statistics.latency) {
+            xassert(latency.publish.percentile(50) <= latency.publish.percentile(99));
+            if (latency.publish.count()) {
+                publishers++;
+            }
+        }
+        // The controller and the target that responded.
+        xassert(publishers >= 2);
+    }
+
+    bus.reset_statistics();
+    bus.latency_histograms(false);
+    auto statistics = bus.statistics();
+    xassert(statistics.events == 0);
+    xassert(statistics.latency.empty());
+}
+
+void test_timing()
+{
+    LOG_INFO << "[ timing ]";
+
+    for (const auto & timing : {Bus::STANDARD_MODE, Bus::FAST_MODE, Bus::FAST_MODE_PLUS}) {
+        Scheduler scheduler;
+        Bus bus(&scheduler);
+        bus.timing(timing);
+        xassert(bus.timing().low == timing.low);
+
+        Target target("T51", 0x51, &bus);
+        ControllerBase controller("C00", &bus);
+
+        scheduler.spawn("T51", [&]
+        {
+            target.run();
+        });
+
+        scheduler.spawn("C00", [&]
+        {
+            using WriteFlag = ControllerBase::WriteFlag;
+            xassert(!controller.write(0xA2, WriteFlag::START));
+            xassert(!controller.write(0x42, WriteFlag::STOP));
+            target.stop();
+        });
+
+        scheduler.run();
+
+        auto statistics = bus.statistics();
+        xassert(statistics.transactions.count() == 1);
+        xassert(statistics.busy <= statistics.time);
+        xassert(statistics.time == bus.time());
+
+        // Two octets and their ACK bits, plus the START and STOP conditions.
+        auto period = timing.low + timing.high + timing.rise + timing.fall;
+        auto duration = statistics.busy;
+        LOG_INFO << "duration " << duration << " ns";
+        xassert(duration >= 18 * period && duration <= 20 * period);
+        xassert(statistics.transactions.percentile(100) <= duration);
+    }
+
+    // The target at 0x53 holds SCL low for three delays before it acknowledges a written octet.
+    Scheduler scheduler;
+    Bus bus(&scheduler);
+    Target t51("T51", 0x51, &bus);
+    Target t53("T53", 0x53, &bus);
+    ControllerBase controller("C00", &bus);
+
+    scheduler.spawn("T51", [&]
+    {
+        t51.run();
+    });
+
+    scheduler.spawn("T53", [&]
+    {
+        t53.run();
+    });
+
+    scheduler.spawn("C00", [&]
+    {
+        using WriteFlag = ControllerBase::WriteFlag;
+        auto time = bus.time();
+        xassert(!controller.write(0xA2, WriteFlag::START));
+        xassert(!controller.write(0x42, WriteFlag::STOP));
+        auto plain = bus.time() - time;
+
+        time = bus.time();
+        xassert(!controller.write(0xA6, WriteFlag::START));
+        xassert(!controller.write(0x42, WriteFlag::STOP));
+        auto stretched = bus.time() - time;
+
+        LOG_INFO << "stretched " << stretched << " ns, plain " << plain << " ns";
+        xassert(stretched >= plain + 3 * Bus::STANDARD_MODE.low);
+
+        t51.stop();
+        t53.stop();
+    });
+
+    scheduler.run();
+}
+
+void test_register_target(bool transaction_level)
+{
+    LOG_INFO << "[ register target" << (transaction_level ? " (transaction level)" : "") << " ]";
+
+    Scheduler scheduler;
+    Bus bus(&scheduler);
+    bus.transaction_level(transaction_level);
+
+    // 64 KiB of registers, with a 2-octet index.
+    RegisterTarget target("T60", 0x60, &bus, 0x10000, 2);
+    xassert(target.size() == 0x10000);
+
+    uint8_t reads = 0;
+    target.on_read(0x0010, 1, [&](std::size_t, uint8_t value)
+    {
+        return static_cast<uint8_t>(value + reads++);
+    });
+    target.on_write(0x0020, 2, [](std::size_t, uint8_t value)
+    {
+        return static_cast<uint8_t>(~value);
+    });
+
+    auto out_of_range = false;
+    try {
+        target.on_read(0xFFFF, 2, nullptr);
+    } catch (const std::out_of_range &) {
+        out_of_range = true;
+    }
+    xassert(out_of_range);
+
+    ControllerBase controller("C00", &bus);
+
+    scheduler.spawn("T60", [&]
+    {
+        target.run();
+    });
+
+    scheduler.spawn("C00", [&]
+    {
+        // The index wraps at the end of the registers.
+        const uint8_t data[] = {0xFF, 0xFE, 0x01, 0x02, 0x03, 0x04};
+        xassert(!controller.write(0x60, data, sizeof data));
+        xassert(target.index() == 2);
+
+        uint8_t buffer[4]{};
+        xassert(!controller.write_then_read(0x60, data, 2, buffer, sizeof buffer));
+        xassert(buffer[0] == 0x01 && buffer[1] == 0x02 && buffer[2] == 0x03 && buffer[3] == 0x04);
 
-    for (auto & target : targets) {
-        target->stop();
+        const uint8_t hooked[] = {0x00, 0x20, 0x0F, 0xF0};
+        xassert(!controller.write(0x60, hooked, sizeof hooked));
+        xassert(!controller.write_then_read(0x60, hooked, 2, buffer, 2));
+        xassert(buffer[0] == 0xF0 && buffer[1] == 0x0F);
+
+        const uint8_t counter[] = {0x00, 0x10};
+        xassert(!controller.write_then_read(0x60, counter, sizeof counter, buffer, 1));
+        xassert(!controller.write_then_read(0x60, counter, sizeof counter, buffer + 1, 1));
+        xassert(buffer[0] == 0 && buffer[1] == 1);
+
+        target.stop();
+    });
+
+    scheduler.run();
+
+    xassert(target.registers()[0xFFFE] == 0x01 && target.registers()[0x0001] == 0x04);
+}
+
+void test_register_file()
+{
+    LOG_INFO << "[ register file ]";
+
+    const char * path = "test_i2c.reg";
+    std::remove(path);
+
+    Bus bus;
+    {
+        RegisterTarget target("T61", 0x61, &bus, 256, 1, path);
+        target.registers()[0x42] = 0x5A;
     }
 
-    for (auto & thread : threads) {
-        thread.join();
+    {
+        RegisterTarget target("T61", 0x61, &bus, 256, 1, path);
+        xassert(target.registers()[0x42] == 0x5A);
+
+        // Each address has one target.
+        auto in_use = false;
+        try {
+            Target other("T61", 0x61, &bus);
+        } catch (const std::invalid_argument &) {
+            in_use = true;
+        }
+        xassert(in_use);
     }
+
+    std::remove(path);
+}
+
+void test_eeprom(bool transaction_level)
+{
+    LOG_INFO << "[ EEPROM" << (transaction_level ? " (transaction level)" : "") << " ]";
+
+    const char * path = "test_i2c.eeprom";
+    std::remove(path);
+
+    {
+        Scheduler scheduler;
+        Bus bus(&scheduler);
+        bus.transaction_level(transaction_level);
+
+        Eeprom eeprom("T50", 0x50, &bus, Eeprom::M24C32, path);
+        ControllerBase controller("C00", &bus);
+
+        scheduler.spawn("T50", [&]
+        {
+            eeprom.run();
+        });
+
+        scheduler.spawn("C00", [&]
+        {
+            // A page write rolls over within the page.
+            const uint8_t page[] = {0x00, 0x1E, 0xAA, 0xBB, 0xCC, 0xDD};
+            xassert(!controller.write(0x50, page, sizeof page));
+            xassert(eeprom.index() == 0x0002);
+
+            // A write without STOP is discarded.
+            const uint8_t aborted[] = {0x00, 0x40, 0x11};
+            uint8_t buffer[4]{};
+            xassert(!controller.write_then_read(0x50, aborted, sizeof aborted, buffer, 1));
+            xassert(buffer[0] == 0x00);
+
+            // A sequential read wraps at the end of the array.
+            const uint8_t end[] = {0x0F, 0xFE};
+            xassert(!controller.write(0x50, end, sizeof end));
+            xassert(!controller.read(0x50, buffer, sizeof buffer));
+            xassert(buffer[0] == 0x00 && buffer[1] == 0x00 && buffer[2] == 0xCC && buffer[3] == 0xDD);
+
+            eeprom.stop();
+        });
+
+        scheduler.run();
+
+        const auto array = eeprom.registers();
+        xassert(array[0x1E] == 0xAA && array[0x1F] == 0xBB && array[0x00] == 0xCC && array[0x01] == 0xDD && array[0x20] == 0x00);
+    }
+
+    // The image persists.
+    {
+        Bus bus;
+        Eeprom eeprom("T50", 0x50, &bus, Eeprom::M24C32, path);
+        xassert(eeprom.registers()[0x1E] == 0xAA);
+    }
+
+    std::remove(path);
+}
+
+void test_ten_bit(bool transaction_level)
+{
+    LOG_INFO << "[ 10-bit addressing" << (transaction_level ? " (transaction level)" : "") << " ]";
+
+    Scheduler scheduler;
+    Bus bus(&scheduler);
+    bus.transaction_level(transaction_level);
+
+    // Two targets share the upper address bits (first octet 0xF6); the first acknowledges the first octet for both.
+    RegisterTarget first("T3A5", Bus::TEN_BIT | 0x3A5, &bus, 256);
+    RegisterTarget second("T3C0", Bus::TEN_BIT | 0x3C0, &bus, 256);
+    Target generic("T0A5", Bus::TEN_BIT | 0x0A5, &bus);
+    RegisterTarget seven("T65", 0x65, &bus, 256);
+    xassert(first.ten_bit() && first.address() == 0x3A5 && !seven.ten_bit());
+
+    auto out_of_range = false;
+    try {
+        RegisterTarget invalid("T400", Bus::TEN_BIT | 0x400, &bus, 1);
+    } catch (const std::out_of_range &) {
+        out_of_range = true;
+    }
+    xassert(out_of_range);
+
+    ControllerBase controller("C00", &bus);
+
+    for (auto target : {&first, &second, &seven}) {
+        scheduler.spawn(target == &seven ? "T65" : "T10", [target]
+        {
+            target->run();
+        });
+    }
+    scheduler.spawn("T0A5", [&]
+    {
+        generic.run();
+    });
+
+    scheduler.spawn("C00", [&]
+    {
+        using Flag = ControllerBase::MessageFlag;
+
+        for (auto target : {&first, &second}) {
+            uint8_t data[] = {0x10, static_cast<uint8_t>(target->address())};
+            uint8_t buffer[1]{};
+            ControllerBase::Message messages[] = {
+                {target->address(), Flag::TEN, sizeof data, data},
+                {target->address(), Flag::TEN, 1, data},
+                {target->address(), Flag::TEN|Flag::READ, sizeof buffer, buffer}
+            };
+            xassert(!controller.transfer(messages, 1));
+            xassert(!controller.transfer(messages + 1, 2));
+            xassert(buffer[0] == static_cast<uint8_t>(target->address()));
+        }
+        xassert(first.registers()[0x10] == 0xA5 && second.registers()[0x10] == 0xC0 && seven.registers()[0x10] == 0x00);
+
+        // A 10-bit read after a repeated START condition continues with the target addressed by the write.
+        uint8_t buffer[2]{};
+        ControllerBase::Message messages[] = {
+            {0x0A5, Flag::TEN|Flag::READ, sizeof buffer, buffer}
+        };
+        xassert(!controller.transfer(messages, 1));
+        xassert(buffer[0] == 0x50 && buffer[1] == 0x51);
+
+        // The first octet is acknowledged, but not the second.
+        messages[0].address = 0x3FF;
+        xassert(controller.transfer(messages, 1));
+        messages[0].address = 0x1A5;
+        xassert(controller.transfer(messages, 1));
+
+        // Octets may be written at edge level.
+        xassert(!controller.write(0xF6, ControllerBase::WriteFlag::START));
+        xassert(!controller.write(0xC0));
+        xassert(!controller.write(0x20));
+        xassert(!controller.write(0x5A, ControllerBase::WriteFlag::STOP));
+        xassert(second.registers()[0x20] == 0x5A);
+
+        first.stop();
+        second.stop();
+        generic.stop();
+        seven.stop();
+    });
+
+    scheduler.run();
+}
+
+void test_arbitration()
+{
+    LOG_INFO << "[ arbitration ]";
+
+    Scheduler scheduler;
+    Bus bus(&scheduler);
+
+    RegisterTarget t50("T50", 0x50, &bus, 256);
+    RegisterTarget t52("T52", 0x52, &bus, 256);
+
+    scheduler.spawn("T50", [&]
+    {
+        t50.run();
+    });
+    scheduler.spawn("T52", [&]
+    {
+        t52.run();
+    });
+
+    // C02 owns the bus while C00 and C01 wait for it to be free; they then send START conditions together.
+    // The address octets 0xA0 and 0xA4 differ in bit 2, where C01 drives SDA high and loses arbitration.
+    auto done = 0;
+    auto finish = [&]
+    {
+        if (++done == 3) {
+            t50.stop();
+            t52.stop();
+        }
+    };
+
+    scheduler.spawn("C02", [&]
+    {
+        ControllerBase controller("C02", &bus);
+        const uint8_t data[] = {0x10, 0x02, 0x02, 0x02, 0x02};
+        xassert(!controller.write(0x50, data, sizeof data));
+        xassert(controller.result() == ControllerBase::Result::ACK);
+        finish();
+    });
+
+    for (auto [name, address] : {std::pair{"C00", uint8_t{0x50}}, std::pair{"C01", uint8_t{0x52}}}) {
+        scheduler.spawn(name, [&, name = name, address = address]
+        {
+            ControllerBase controller(name, &bus);
+            const uint8_t data[] = {0x00, address};
+            auto lost = controller.write(address, data, sizeof data);
+            xassert(lost == (address == 0x52));
+            xassert(controller.result() == (lost ? ControllerBase::Result::ARBITRATION_LOST : ControllerBase::Result::ACK));
+
+            // The controller that lost retries when the bus is free.
+            xassert(!controller.write(address, data, sizeof data));
+            finish();
+        });
+    }
+
+    scheduler.run();
+
+    xassert(t50.registers()[0x00] == 0x50 && t50.registers()[0x10] == 0x02 && t52.registers()[0x00] == 0x52);
+
+    // C00 and C01 read 1 and 2 octets from T50 together.  C00 does not acknowledge the octet that C01 acknowledges,
+    // so loses arbitration on the acknowledgement bit.
+    Scheduler readers;
+    Bus shared(&readers);
+    RegisterTarget target("T50", 0x50, &shared, 256);
+    target.registers()[0x00] = 0x11;
+    target.registers()[0x01] = 0x22;
+    done = 0;
+
+    readers.spawn("T50", [&]
+    {
+        target.run();
+    });
+
+    auto stop = [&]
+    {
+        if (++done == 3) {
+            target.stop();
+        }
+    };
+
+    readers.spawn("C02", [&]
+    {
+        ControllerBase controller("C02", &shared);
+        const uint8_t index[] = {0x00};
+        xassert(!controller.write(0x50, index, sizeof index));
+        stop();
+    });
+
+    for (auto [name, length] : {std::pair{"C00", std::size_t{1}}, std::pair{"C01", std::size_t{2}}}) {
+        readers.spawn(name, [&, name = name, length = length]
+        {
+            ControllerBase controller(name, &shared);
+            uint8_t buffer[2]{};
+            auto lost = controller.read(0x50, buffer, length);
+            xassert(lost == (length == 1));
+            xassert(controller.result() == (lost ? ControllerBase::Result::ARBITRATION_LOST : ControllerBase::Result::ACK));
+            xassert(lost || (buffer[0] == 0x11 && buffer[1] == 0x22));
+
+            if (lost) {
+                xassert(!controller.read(0x50, buffer, length));
+            }
+            stop();
+        });
+    }
+
+    readers.run();
+}
+
+void test_bus_hang()
+{
+    LOG_INFO << "[ bus hang (timeout, watchdog, recover) ]";
+
+    Scheduler scheduler;
+    Bus bus(&scheduler);
+    Watchdog watchdog(&bus, std::chrono::milliseconds(10));
+
+    RegisterTarget t50("T50", 0x50, &bus, 256);
+
+    scheduler.spawn("T50", [&]
+    {
+        t50.run();
+    });
+
+    // A rogue node holds SCL low while publishing delays, then holds SCL low and waits, then holds SDA low and waits.
+    // Each controller wakes the rogue when done, and is destroyed (so detached) before the rogue publishes again.
+    auto publishing = true;
+    Node * rogue = nullptr;
+    const uint8_t data[] = {0x00, 0x5A};
+
+    scheduler.spawn("R", [&]
+    {
+        {
+            Node node("R", &bus);
+            rogue = &node;
+            node.scl(Line::Level::Low);
+            while (publishing) {
+                node.delay();
+            }
+            node.wait_for_symbol();
+
+            node.sda(Line::Level::Low);
+            node.scl(Line::Level::High);
+            scheduler.spawn("C1", [&]
+            {
+                ControllerBase controller("C1", &bus);
+
+                // SDA stuck low, without a START condition.
+                xassert(controller.write(0x50, data, sizeof data));
+                xassert(controller.result() == ControllerBase::Result::TIMEOUT);
+                xassert(controller.recover() == -EBUSY);
+                rogue->wake();
+            });
+            node.wait_for_symbol();
+            node.sda(Line::Level::High);
+        }
+
+        // The bus is free again.
+        ControllerBase controller("C2", &bus);
+        xassert(!controller.write(0x50, data, sizeof data));
+        xassert(controller.recover() == 0);
+        xassert(t50.registers()[0x00] == 0x5A);
+        t50.stop();
+    });
+
+    scheduler.spawn("C0", [&]
+    {
+        ControllerBase controller("C0", &bus);
+        watchdog.watch(&controller);
+
+        // Simulated time advances while SCL is stretched.
+        controller.timeout({100000, std::chrono::nanoseconds::zero()});
+        xassert(controller.write(0x50, data, sizeof data));
+        xassert(controller.result() == ControllerBase::Result::TIMEOUT);
+        xassert(controller.recover() == -ETIMEDOUT);
+        publishing = false;
+
+        // Simulated time stands still: the watchdog aborts the transfer, then the recovery.
+        controller.timeout({0, std::chrono::nanoseconds::zero()});
+        xassert(controller.write(0x50, data, sizeof data));
+        xassert(controller.result() == ControllerBase::Result::TIMEOUT);
+        xassert(watchdog.expirations() >= 2);
+
+        controller.timeout({0, std::chrono::milliseconds(1)});
+        xassert(controller.recover() == -ETIMEDOUT);
+
+        watchdog.unwatch(&controller);
+        rogue->wake();
+    });
+
+    scheduler.run();
+}
+
+void test_bus_wedged()
+{
+    LOG_INFO << "[ bus wedged ]";
+
+    // A node sends a START condition, then detaches: the bus stays busy, and no events are published.
+    // The controller's default timeout abandons the wait for the bus, and recovers it.
+    // (The nodes share a thread, so only one is attached while publishing.)
+    auto wedge = [](Bus * bus)
+    {
+        {
+            Node node("R", bus);
+            node.sda(Line::Level::Low);
+            node.scl(Line::Level::Low);
+            node.sda(Line::Level::High);
+            node.scl(Line::Level::High);
+            xassert(node.busy());
+        }
+
+        ControllerBase controller("C00", bus);
+        const uint8_t data[] = {0x00};
+        xassert(controller.write(0x50, data, sizeof data));
+        xassert(controller.result() == ControllerBase::Result::TIMEOUT);
+
+        Node observer("O", bus);
+        xassert(!observer.busy());
+    };
+
+    {
+        Bus bus;
+        wedge(&bus);
+    }
+
+    {
+        Scheduler scheduler;
+        Bus bus(&scheduler);
+        scheduler.spawn("R", [&]
+        {
+            wedge(&bus);
+        });
+        scheduler.run();
+    }
+}
+
+void test_detach()
+{
+    LOG_INFO << "[ detach ]";
+
+    Bus bus;
+
+    // A node that detaches releases SDA, which wakes a node parked until SDA is high.
+    auto holder = std::make_unique<Node>("H", &bus);
+    holder->sda(Line::Level::Low);
+
+    std::promise<void> attached;
+    std::thread waiter([&]
+    {
+        Node node("W", &bus);
+        attached.set_value();
+        auto [sda, scl] = node.wait_for_sda(Line::Level::High);
+        xassert(sda == Line::Level::High && scl == Line::Level::High);
+    });
+
+    attached.get_future().wait();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    holder.reset();
+    waiter.join();
+}
+
+void test_pec()
+{
+    LOG_INFO << "[ PEC ]";
+
+    // The CRC-8 check value.
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    xassert(Pec::compute(check, sizeof check) == 0xF4);
+
+    Pec pec;
+    pec.update(check, 4);
+    pec.update(check + 4, sizeof check - 4);
+    xassert(pec.value() == 0xF4);
+
+    // Eight octets per step agree with one octet per step, for every length and alignment.
+    std::vector<uint8_t> data(64);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<uint8_t>(i * 37 + 11);
+    }
+
+    for (std::size_t offset = 0; offset < 8; ++offset) {
+        for (std::size_t length = 0; offset + length <= data.size(); ++length) {
+            Pec octets{0x5A};
+            for (std::size_t i = 0; i < length; ++i) {
+                octets.update(data[offset + i]);
+            }
+            xassert(Pec::compute(data.data() + offset, length, 0x5A) == octets.value());
+        }
+    }
+}
+
+void test_log()
+{
+    LOG_INFO << "[ log ]";
+
+    // Octets format as at least two upper-case ASCIIHEX digits, at compile time.
+    static_assert(Log::octet(0x5).view() == "05");
+    static_assert(Log::octet(0x1AB).view() == "1AB");
+    static_assert(Log::octet(0x1AB).value() == 0x1AB);
+    xassert(Log::octet(-1).view() == "FFFFFFFF");
+
+    xassert(std::string(Log::octet(0xAB)) == "AB");
+    xassert(std::string("T") + Log::octet(0x50) == "T50");
+    xassert("T" + Log::octet(0x5) == "T05");
+
+    // Capture the drained messages.
+    Log::flush();
+    std::stringstream captured;
+    auto * buffer = std::cout.rdbuf(captured.rdbuf());
+    auto prefix = Log::prefix();
+
+    // Messages are drained in timestamp order, although this thread's ring is drained first.
+    std::thread([]{
+        Log::set_prefix("L1");
+        LOG_INFO << "first";
+    }).join();
+    Log::set_prefix("L0");
+    LOG_INFO << "second";
+
+    // Each value is recorded in binary form, and formatted when drained.
+    LOG_INFO << "text " << std::string("string ") << -5 << ' ' << 7u << ' ' << Log::octet(0xA) << ' ' << 1.5;
+
+    // Text is truncated to fit the 114 bytes of a record, less its tag and size, and values past the end are dropped.
+    LOG_INFO << std::string(200, 'x') << 1;
+
+    // Operands of disabled messages are not evaluated.
+    auto evaluated = false;
+    auto operand = [&]{ evaluated = true; return "hidden"; };
+    Log::set_level(Log::Level::Off);
+    LOG_INFO << operand();
+    Log::set_level(Log::Level::Info);
+    LOG_DEBUG << operand();
+    xassert(!evaluated);
+
+    // Nor are operands below the minimum level, even when enabled.
+    if constexpr (Log::MIN_LEVEL > Log::Level::Debug) {
+        Log::set_level(Log::Level::Debug);
+        LOG_DEBUG << operand();
+        Log::set_level(Log::Level::Info);
+        xassert(!evaluated);
+    }
+
+    Log::flush();
+    std::cout.rdbuf(buffer);
+    Log::set_prefix(prefix);
+
+    auto output = captured.str();
+    auto first = output.find("L1\tfirst\n");
+    auto second = output.find("L0\tsecond\n");
+    xassert(first != std::string::npos && second != std::string::npos && first < second);
+    xassert(output.find("L0\ttext string -5 7 0A 1.5\n") != std::string::npos);
+    xassert(output.find("L0\t" + std::string(112, 'x') + "\n") != std::string::npos);
+    xassert(output.find("hidden") == std::string::npos);
+}
+
+void test_smbus(bool transaction_level)
+{
+    LOG_INFO << "[ SMBus" << (transaction_level ? " (transaction level)" : "") << " ]";
+
+    Scheduler scheduler;
+    Bus bus(&scheduler);
+    bus.transaction_level(transaction_level);
+
+    constexpr uint8_t BYTE = 0x10;
+    constexpr uint8_t WORD = 0x20;
+    constexpr uint8_t BLOCK = 0x30;
+    constexpr uint8_t CALL = 0x40;
+
+    SmbusTarget target("T40", 0x40, &bus);
+    target.command(WORD, SmbusTarget::Protocol::Word);
+    target.command(BLOCK, SmbusTarget::Protocol::Block);
+    target.command(CALL, [](uint8_t command, uint16_t value)
+    {
+        return static_cast<uint16_t>(~value + command);
+    });
+
+    ControllerBase controller("C00", &bus);
+    Smbus smbus(&controller);
+
+    scheduler.spawn("T40", [&]
+    {
+        target.run();
+    });
+
+    scheduler.spawn("C00", [&]
+    {
+        std::vector<uint8_t> block(Smbus::BLOCK_MAX + 1);
+        for (std::size_t i = 0; i < block.size(); ++i) {
+            block[i] = static_cast<uint8_t>(i ^ 0xA5);
+        }
+        uint8_t buffer[Smbus::BLOCK_MAX]{};
+
+        for (auto pec : {false, true}) {
+            smbus.pec(pec);
+            target.pec(pec);
+            xassert(smbus.pec() == pec);
+            target.value(BYTE, {0x5A});
+
+            xassert(smbus.write_byte(0x40, BYTE) == 0);
+            xassert(smbus.read_byte(0x40) == 0x5A);
+
+            xassert(smbus.write_byte_data(0x40, BYTE, pec ? 0xC3 : 0x3C) == 0);
+            xassert(target.value(BYTE) == std::vector<uint8_t>{static_cast<uint8_t>(pec ? 0xC3 : 0x3C)});
+            xassert(smbus.read_byte_data(0x40, BYTE) == (pec ? 0xC3 : 0x3C));
+
+            xassert(smbus.write_word_data(0x40, WORD, 0xBEEF) == 0);
+            xassert(target.value(WORD) == (std::vector<uint8_t>{0xEF, 0xBE}));
+            xassert(smbus.read_word_data(0x40, WORD) == 0xBEEF);
+
+            xassert(smbus.process_call(0x40, CALL, 0x1234) == static_cast<uint16_t>(~0x1234 + CALL));
+
+            // The largest block.
+            xassert(smbus.write_block_data(0x40, BLOCK, block.data(), Smbus::BLOCK_MAX) == 0);
+            xassert(target.value(BLOCK).size() == Smbus::BLOCK_MAX);
+            xassert(smbus.read_block_data(0x40, BLOCK, buffer) == static_cast<int>(Smbus::BLOCK_MAX));
+            xassert(std::equal(buffer, buffer + Smbus::BLOCK_MAX, block.begin()));
+
+            xassert(smbus.write_block_data(0x40, BLOCK, block.data() + 1, 3) == 0);
+            xassert(smbus.read_block_data(0x40, BLOCK, buffer) == 3);
+            xassert(buffer[0] == block[1] && buffer[2] == block[3]);
+
+            xassert(smbus.read_byte_data(0x41, BYTE) == -ENXIO);
+            xassert(smbus.read_block_data(0x41, BLOCK, buffer) == -ENXIO);
+        }
+
+        xassert(smbus.write_block_data(0x40, BLOCK, block.data(), block.size()) == -EINVAL);
+
+        // The target does not send a PEC.
+        target.pec(false);
+        xassert(smbus.read_word_data(0x40, WORD) == -EBADMSG);
+        xassert(smbus.read_block_data(0x40, BLOCK, buffer) == -EBADMSG);
+
+        // A write with an incorrect PEC is not acknowledged, and discarded.
+        const uint8_t data[] = {0x40 << ADDRESS_SHIFT, WORD, 0x01, 0x02};
+        xassert(!controller.write(data[0], ControllerBase::WriteFlag::START));
+        for (std::size_t i = 1; i < sizeof data; ++i) {
+            xassert(!controller.write(data[i]));
+        }
+        xassert(controller.write(static_cast<uint8_t>(Pec::compute(data, sizeof data) ^ 0x01)));
+        controller.stop();
+        // No transaction is in progress.
+        controller.stop();
+        xassert(target.pec_errors() == 1);
+        xassert(target.value(WORD) == (std::vector<uint8_t>{0xEF, 0xBE}));
+
+        // With PEC enabled, a write without a PEC is discarded.
+        target.pec(true);
+        smbus.pec(false);
+        xassert(smbus.write_word_data(0x40, WORD, 0x0102) == 0);
+        xassert(target.pec_errors() == 2);
+        xassert(target.value(WORD) == (std::vector<uint8_t>{0xEF, 0xBE}));
+
+        // A block read without octets.
+        target.command(BLOCK, SmbusTarget::Protocol::Block);
+        xassert(smbus.read_block_data(0x40, BLOCK, buffer) == -EPROTO);
+
+        target.stop();
+    });
+
+    scheduler.run();
+}
+
+} // namespace
+
+int main()
+{
+    Log::set_level(Log::Level::Info);
+
+    test_threaded(false);
+    test_threaded(true);
+    test_wait_policy(Bus::WaitPolicy::Spin);
+    test_wait_policy(Bus::WaitPolicy::SpinYield);
+    test_wait_policy(Bus::WaitPolicy::Park);
+    test_async();
+    test_cooperative();
+    test_farm();
+    test_deadlock();
+    test_task_exception();
+    test_trace();
+    test_decoder();
+    test_statistics();
+    test_timing();
+    test_register_target(false);
+    test_register_target(true);
+    test_register_file();
+    test_eeprom(false);
+    test_eeprom(true);
+    test_ten_bit(false);
+    test_ten_bit(true);
+    test_arbitration();
+    test_bus_hang();
+    test_bus_wedged();
+    test_detach();
+    test_pec();
+    test_smbus(false);
+    test_smbus(true);
+    test_log();
 }
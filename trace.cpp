@@ -0,0 +1,235 @@
+#include "trace.hpp"
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+class Trace::Impl
+{
+    struct Record
+    {
+        uint64_t sequence;
+        uint64_t time;
+        uint32_t handle;
+        uint8_t event;
+        /// Bit 0 SDA, bit 1 SCL.
+        uint8_t levels;
+    };
+
+    /// VCD file.
+    std::ofstream file_;
+
+    /// Number of records per buffer.
+    std::size_t capacity_;
+
+    /// Buffer being filled by the bus.
+    std::vector<Record> active_;
+
+    /// Buffer being written by the writer thread.
+    std::vector<Record> spare_;
+
+    /// This mutex protects the following member variables.
+    std::mutex mutex_;
+
+    /// True while the writer thread owns the spare buffer.
+    bool busy_;
+
+    /// True when the writer thread should exit.
+    bool stopping_;
+
+    /// Signalled when busy_ or stopping_ changes.
+    std::condition_variable condition_;
+
+    /// Writer state: the previous record, and the last timestamp written.
+    Record previous_;
+    uint64_t time_;
+
+    /// Writer thread.
+    std::thread thread_;
+
+    /// Append a VCD integer value.
+    static void vector(std::string & out, uint64_t value, char id)
+    {
+        char bits[65];
+        auto size = 0;
+        do {
+            bits[size++] = static_cast<char>('0' + (value & 1));
+            value >>= 1;
+        } while (value);
+
+        out += 'b';
+        while (size) {
+            out += bits[--size];
+        }
+        out += ' ';
+        out += id;
+        out += '\n';
+    }
+
+    void header()
+    {
+        std::string out;
+        out += "$version i2c $end\n";
+        out += "$comment Time is the simulated bus time. $end\n";
+        out += "$timescale 1 ns $end\n";
+        out += "$scope module bus $end\n";
+        out += "$var wire 1 ! sda $end\n";
+        out += "$var wire 1 \" scl $end\n";
+        out += "$var integer 32 # node $end\n";
+        out += "$var integer 8 $ event $end\n";
+        out += "$var integer 64 % sequence $end\n";
+        out += "$upscope $end\n";
+        out += "$enddefinitions $end\n";
+        out += "#0\n";
+        out += "$dumpvars\n1!\n1\"\n";
+        vector(out, previous_.handle, '#');
+        vector(out, previous_.event, '$');
+        vector(out, previous_.sequence, '%');
+        out += "$end\n";
+        file_ << out;
+    }
+
+    /// Format and write the spare buffer.
+    void write()
+    {
+        std::string out;
+        out.reserve(spare_.size() * 32);
+
+        for (const auto & record : spare_) {
+            // Events that take no simulated time (such as SDA changes) share a timestamp.  Time may step back by the
+            // difference between tHIGH and the set-up time of a START or STOP condition; it is then held.
+            if (record.time > time_) {
+                time_ = record.time;
+                out += '#';
+                out += std::to_string(time_);
+                out += '\n';
+            }
+
+            auto changed = record.levels ^ previous_.levels;
+            if (changed & 1) {
+                out += (record.levels & 1) ? "1!\n" : "0!\n";
+            }
+            if (changed & 2) {
+                out += (record.levels & 2) ? "1\"\n" : "0\"\n";
+            }
+            if (record.handle != previous_.handle) {
+                vector(out, record.handle, '#');
+            }
+            if (record.event != previous_.event) {
+                vector(out, record.event, '$');
+            }
+            if (record.sequence != previous_.sequence) {
+                vector(out, record.sequence, '%');
+            }
+
+            previous_ = record;
+        }
+
+        file_ << out;
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            condition_.wait(lock, [&]{
+                return busy_ || stopping_;
+            });
+            if (!busy_) {
+                return;
+            }
+
+            lock.unlock();
+            write();
+            spare_.clear();
+            lock.lock();
+
+            busy_ = false;
+            condition_.notify_all();
+        }
+    }
+
+    /// Hand the active buffer to the writer thread, once it has finished with the spare buffer.
+    void submit()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock, [&]{
+            return !busy_;
+        });
+
+        std::swap(active_, spare_);
+        busy_ = true;
+        condition_.notify_all();
+    }
+
+public:
+    Impl(const std::string & path, std::size_t capacity) : file_{path}, capacity_{capacity}, active_{}, spare_{}, mutex_{}, busy_{}, stopping_{}, condition_{}, previous_{0, 0, 0, 0, 3}, time_{}, thread_{}
+    {
+        if (!file_) {
+            throw std::runtime_error("cannot open trace file " + path);
+        }
+
+        active_.reserve(capacity_);
+        spare_.reserve(capacity_);
+
+        header();
+
+        thread_ = std::thread([this]{
+            run();
+        });
+    }
+
+    ~Impl()
+    {
+        flush();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        condition_.notify_all();
+        thread_.join();
+    }
+
+    void record(uint64_t sequence, uint64_t time, Bus::Handle handle, Bus::Event event, Line::Level sda, Line::Level scl)
+    {
+        auto levels = (sda == Line::Level::High ? 1U : 0U) | (scl == Line::Level::High ? 2U : 0U);
+        active_.push_back({sequence, time, static_cast<uint32_t>(handle), static_cast<uint8_t>(event), static_cast<uint8_t>(levels)});
+
+        if (active_.size() == capacity_) {
+            submit();
+        }
+    }
+
+    void flush()
+    {
+        if (!active_.empty()) {
+            submit();
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock, [&]{
+            return !busy_;
+        });
+        file_.flush();
+    }
+};
+
+Trace::Trace(const std::string & path, std::size_t capacity) : pimpl{std::make_unique<Impl>(path, capacity)}
+{
+}
+
+Trace::~Trace() = default;
+
+void Trace::event(uint64_t sequence, uint64_t time, Bus::Handle handle, const Node *, Bus::Event event, Line::Level sda, Line::Level scl)
+{
+    pimpl->record(sequence, time, handle, event, sda, scl);
+}
+
+void Trace::flush()
+{
+    pimpl->flush();
+}
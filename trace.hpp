@@ -0,0 +1,43 @@
+#pragma once
+
+#include "bus.hpp"
+#include "monitorinterface.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/// Trace class.
+/// @discussion Records the events processed by a bus (to which it is attached as a monitor) to a Value Change Dump
+/// (VCD) file, for viewing with GTKWave.
+/// Each event is appended as a fixed-size record to a preallocated buffer.  When the buffer fills, it is handed to
+/// a writer thread (which formats and writes it while a second buffer fills), so memory use is bounded.
+/// The VCD time is the simulated time of the bus (see @c Bus::time()), in ns: events that take no simulated time,
+/// such as SDA changes, share a timestamp.  Besides SDA and SCL, the dump shows the handle of the node that
+/// caused the event, the event, and the bus sequence number.
+class Trace : public MonitorInterface
+{
+    class Impl;
+    std::unique_ptr<Impl> pimpl;
+
+public:
+    /// Default number of records per buffer.
+    static constexpr std::size_t DEFAULT_CAPACITY = 4096;
+
+    /// Constructor.
+    /// @param path The VCD file to write.
+    /// @param capacity The number of records per buffer (two buffers are allocated).
+    explicit Trace(const std::string & path, std::size_t capacity = DEFAULT_CAPACITY);
+
+    /// Destructor.
+    /// @discussion Writes remaining records.
+    ~Trace() override;
+
+    /// Record an event.
+    void event(uint64_t sequence, uint64_t time, Bus::Handle handle, const Node * node, Bus::Event event, Line::Level sda, Line::Level scl) override;
+
+    /// Write all records.
+    /// @discussion Must not be called while an attached bus is processing events.
+    void flush();
+};
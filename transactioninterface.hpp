@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+/// Transaction interface class.
+/// @discussion Models the octet-level behaviour of an I²C target.
+/// When transaction-level simulation is enabled on a bus, a controller exchanges octets with the addressed target
+/// through this interface instead of driving SDA and SCL.
+class TransactionInterface
+{
+public:
+    /// Destructor.
+    virtual ~TransactionInterface() = default;
+
+    /// @return bool True if the target must be simulated at edge level (for example, to stretch the clock).
+    virtual bool edge_level() const = 0;
+
+    /// Start condition.
+    /// @discussion The controller sent a START (or repeated START) condition followed by @c octet, which matches the address of the target.
+    /// @param octet The first octet.
+    /// @return bool True to acknowledge.
+    virtual bool transaction_start(uint8_t octet) = 0;
+
+    /// Controller write.
+    /// @param octet The octet written by the controller.
+    /// @return bool True to acknowledge.
+    virtual bool transaction_write(uint8_t octet) = 0;
+
+    /// Controller read.
+    /// @param nack True if the controller will not acknowledge the octet.
+    /// @return uint8_t The octet to send.
+    virtual uint8_t transaction_read(bool nack) = 0;
+
+    /// Stop condition.
+    /// @discussion The transaction is complete (or abandoned).
+    virtual void transaction_stop() = 0;
+};
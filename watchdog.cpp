@@ -0,0 +1,139 @@
+#include "watchdog.hpp"
+
+#include "controllerbase.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Watchdog::Impl
+{
+    Bus * bus_;
+
+    std::chrono::nanoseconds timeout_;
+
+    /// Number of events processed by the bus.
+    std::atomic<uint64_t> events_;
+
+    /// True if both lines were high after the last event.
+    std::atomic_bool released_;
+
+    std::atomic<uint64_t> expirations_;
+
+    /// This mutex protects the following member variables.
+    std::mutex mutex_;
+
+    std::vector<ControllerBase *> controllers_;
+
+    /// True when the watchdog thread should exit.
+    bool stopping_;
+
+    /// Signalled when stopping_ changes.
+    std::condition_variable condition_;
+
+    /// Watchdog thread.
+    std::thread thread_;
+
+    /// Check the bus several times per timeout, until stopped.
+    void run()
+    {
+        auto events = events_.load();
+        auto progress = std::chrono::steady_clock::now();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!condition_.wait_for(lock, timeout_ / 4, [this] { return stopping_; })) {
+            auto now = std::chrono::steady_clock::now();
+
+            if (events != events_ || released_) {
+                events = events_;
+                progress = now;
+            } else if (now - progress >= timeout_) {
+                LOG_DEBUG << "watchdog expired";
+
+                ++expirations_;
+                for (auto controller : controllers_) {
+                    controller->abort();
+                }
+                progress = now;
+            }
+        }
+    }
+
+public:
+    Impl(Bus * bus, std::chrono::nanoseconds timeout) : bus_{bus}, timeout_{timeout}, events_{}, released_{true}, expirations_{}, mutex_{}, controllers_{}, stopping_{}, condition_{}, thread_{}
+    {
+        thread_ = std::thread(&Impl::run, this);
+    }
+
+    ~Impl()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        condition_.notify_one();
+        thread_.join();
+    }
+
+    Bus * bus() const
+    {
+        return bus_;
+    }
+
+    void watch(ControllerBase * controller)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        controllers_.push_back(controller);
+    }
+
+    void unwatch(ControllerBase * controller)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        controllers_.erase(std::remove(controllers_.begin(), controllers_.end(), controller), controllers_.end());
+    }
+
+    uint64_t expirations() const
+    {
+        return expirations_;
+    }
+
+    void event(Line::Level sda, Line::Level scl)
+    {
+        released_.store(sda == Line::Level::High && scl == Line::Level::High, std::memory_order_relaxed);
+        events_.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+Watchdog::Watchdog(Bus * bus, std::chrono::nanoseconds timeout) : pimpl{std::make_unique<Impl>(bus, timeout)}
+{
+    bus->attach(this);
+}
+
+Watchdog::~Watchdog()
+{
+    pimpl->bus()->detach(this);
+}
+
+void Watchdog::watch(ControllerBase * controller)
+{
+    pimpl->watch(controller);
+}
+
+void Watchdog::unwatch(ControllerBase * controller)
+{
+    pimpl->unwatch(controller);
+}
+
+uint64_t Watchdog::expirations() const
+{
+    return pimpl->expirations();
+}
+
+void Watchdog::event(uint64_t, uint64_t, Bus::Handle, const Node *, Bus::Event, Line::Level sda, Line::Level scl)
+{
+    pimpl->event(sda, scl);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "bus.hpp"
+#include "monitorinterface.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+class ControllerBase;
+
+/// Watchdog class.
+/// @discussion Detects a hung bus: SDA or SCL held low while no node publishes an event for longer than a timeout
+/// of wall-clock time (simulated time does not advance then, so a clock stretching timeout cannot expire).
+/// The watchdog then aborts the operations of the controllers that it watches (see @c ControllerBase::abort()),
+/// which abandon the transaction with @c ControllerBase::Result::TIMEOUT and recover the bus.
+/// The watchdog attaches itself to the bus as a monitor, and checks it from its own thread.
+class Watchdog : public MonitorInterface
+{
+    class Impl;
+    std::unique_ptr<Impl> pimpl;
+
+public:
+    /// Constructor.
+    /// @param bus The bus to watch.
+    /// @param timeout The time for which the bus may hang.
+    Watchdog(Bus * bus, std::chrono::nanoseconds timeout);
+
+    /// Destructor.
+    /// @discussion Detaches from the bus.
+    ~Watchdog() override;
+
+    /// Watch a controller, which is aborted when the bus hangs.
+    /// @discussion The controller must be unwatched before it is destroyed.
+    void watch(ControllerBase * controller);
+
+    /// Stop watching a controller.
+    void unwatch(ControllerBase * controller);
+
+    /// @return uint64_t The number of times that the bus was found hung.
+    uint64_t expirations() const;
+
+    /// Record an event.
+    void event(uint64_t sequence, uint64_t time, Bus::Handle handle, const Node * node, Bus::Event event, Line::Level sda, Line::Level scl) override;
+};